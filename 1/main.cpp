@@ -3,305 +3,5732 @@
 #include <unordered_map>
 #include <unordered_set>
 #include <list>
+#include <queue>
 #include <chrono>
 #include <random>
 #include <tuple>
 #include <cstdlib>
+#include <climits>
+#include <cmath>
+#include <algorithm>
+#include <memory>
+#include <future>
+#include <variant>
+#include <optional>
+#include <type_traits>
+#include <string>
+#include <stdexcept>
+#include <exception>
+#include <thread>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <filesystem>
+#include <fstream>
+#include <cctype>
+#include <charconv>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <numeric>
+#ifdef __unix__
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#endif
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include <sys/uio.h>
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#define GRAPH_IO_URING 1
+#endif
+#endif
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
 
 using namespace std;
 using namespace chrono;
 
-// Список дуг
-class EdgeListGraph {
+// Политика страниц для больших массивов графа (I, J, weights, H, L)
+enum class PagePolicy {
+    Default, // Как решит ядро (режим THP системы)
+    SmallPages, // Только страницы 4 КБ (MADV_NOHUGEPAGE)
+    HugePages // Страницы 2 МБ: hugetlbfs (MAP_HUGETLB), при нехватке — прозрачные (MADV_HUGEPAGE)
+};
+
+// Политика для новых выделений; уже выделенные массивы сохраняют свои страницы
+inline std::atomic<PagePolicy>& graphPagePolicy() {
+    static std::atomic<PagePolicy> policy{PagePolicy::Default};
+    return policy;
+}
+
+constexpr size_t cacheLineSize = 64;
+constexpr size_t hugePageSize = size_t(2) << 20;
+
+// Аллокатор массивов графа: блоки выравниваются по строке кэша, блоки от 2 МБ — по границе
+// большой страницы и размещаются по graphPagePolicy(). Способ выделения определяется только
+// размером, поэтому освобождение верно при любой текущей политике
+template<class T>
+class GraphAllocator {
+public:
+    using value_type = T;
+
+    GraphAllocator() = default;
+
+    template<class U>
+    GraphAllocator(const GraphAllocator<U>&) {}
+
+    T* allocate(size_t n) {
+        size_t bytes = n * sizeof(T);
+        if (bytes < hugePageSize) {
+            return static_cast<T*>(::operator new(bytes, std::align_val_t(cacheLineSize)));
+        }
+#ifdef __linux__
+        size_t length = roundUp(bytes);
+        PagePolicy policy = graphPagePolicy().load(std::memory_order_relaxed);
+        if (policy == PagePolicy::HugePages) {
+            void* p = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            if (p != MAP_FAILED) return static_cast<T*>(p);
+        }
+        // Выделение с запасом и обрезка до границы 2 МБ
+        char* raw = static_cast<char*>(
+                mmap(nullptr, length + hugePageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+        if (raw == MAP_FAILED) throw std::bad_alloc();
+        char* aligned = raw + (hugePageSize - reinterpret_cast<uintptr_t>(raw) % hugePageSize) % hugePageSize;
+        if (aligned > raw) munmap(raw, aligned - raw);
+        munmap(aligned + length, raw + hugePageSize - aligned);
+        if (policy == PagePolicy::HugePages) madvise(aligned, length, MADV_HUGEPAGE);
+        if (policy == PagePolicy::SmallPages) madvise(aligned, length, MADV_NOHUGEPAGE);
+        return reinterpret_cast<T*>(aligned);
+#else
+        return static_cast<T*>(::operator new(bytes, std::align_val_t(hugePageSize)));
+#endif
+    }
+
+    void deallocate(T* p, size_t n) {
+        size_t bytes = n * sizeof(T);
+        if (bytes < hugePageSize) {
+            ::operator delete(p, std::align_val_t(cacheLineSize));
+            return;
+        }
+#ifdef __linux__
+        munmap(p, roundUp(bytes));
+#else
+        ::operator delete(p, std::align_val_t(hugePageSize));
+#endif
+    }
+
+    template<class U>
+    bool operator==(const GraphAllocator<U>&) const {
+        return true;
+    }
+
+    template<class U>
+    bool operator!=(const GraphAllocator<U>&) const {
+        return false;
+    }
+
+private:
+    static size_t roundUp(size_t bytes) {
+        return (bytes + hugePageSize - 1) / hugePageSize * hugePageSize;
+    }
+};
+
+// Счётчик промахов TLB данных текущего потока через perf_event_open (только Linux, пользовательский режим)
+class DtlbMissCounter {
+public:
+    DtlbMissCounter() {
+#ifdef __linux__
+        perf_event_attr attr{};
+        attr.type = PERF_TYPE_HW_CACHE;
+        attr.size = sizeof(attr);
+        attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                      (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        descriptor = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+#endif
+    }
+
+    DtlbMissCounter(const DtlbMissCounter&) = delete;
+    DtlbMissCounter& operator=(const DtlbMissCounter&) = delete;
+
+    ~DtlbMissCounter() {
+#ifdef __linux__
+        if (descriptor >= 0) close(descriptor);
+#endif
+    }
+
+    // Доступен ли счётчик (ядро и права позволяют)
+    bool available() const {
+        return descriptor >= 0;
+    }
+
+    void start() {
+#ifdef __linux__
+        if (descriptor < 0) return;
+        ioctl(descriptor, PERF_EVENT_IOC_RESET, 0);
+        ioctl(descriptor, PERF_EVENT_IOC_ENABLE, 0);
+#endif
+    }
+
+    // Промахи с момента start (-1, если счётчик недоступен)
+    long long stop() {
+#ifdef __linux__
+        long long count = 0;
+        if (descriptor < 0) return -1;
+        ioctl(descriptor, PERF_EVENT_IOC_DISABLE, 0);
+        return read(descriptor, &count, sizeof(count)) == sizeof(count) ? count : -1;
+#else
+        return -1;
+#endif
+    }
+
+private:
+    int descriptor = -1;
+};
+
+// Объём анонимной памяти процесса в прозрачных больших страницах, КБ (-1, если неизвестно)
+inline long long anonHugePagesKb() {
+    std::ifstream smaps("/proc/self/smaps_rollup");
+    std::string line;
+    while (std::getline(smaps, line)) {
+        if (line.compare(0, 14, "AnonHugePages:") == 0) return std::atoll(line.c_str() + 14);
+    }
+    return -1;
+}
+
+// Число потоков по умолчанию для параллельных операций
+inline unsigned hardwareThreads() {
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+// Параллельный цикл: диапазон [0, n) делится на threads частей, f(begin, end, part)
+template<class F>
+void parallelFor(size_t n, unsigned threads, F f) {
+    threads = std::max(1u, std::min<unsigned>(threads, n / 4096 + 1));
+    if (threads == 1) {
+        f(size_t(0), n, 0u);
+        return;
+    }
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] { f(n * t / threads, n * (t + 1) / threads, t); });
+    }
+    for (auto& worker : workers) worker.join();
+}
+
+// Ключ дуги (from, to), сохраняющий порядок пар знаковых номеров
+inline uint64_t edgeKey(int from, int to) {
+    return (static_cast<uint64_t>(static_cast<uint32_t>(from) ^ 0x80000000u) << 32) |
+           (static_cast<uint32_t>(to) ^ 0x80000000u);
+}
+
+// Устойчивая перестановка дуг по (from, to): параллельная поразрядная сортировка (LSD) по байтам ключа
+std::vector<int> sortedEdgeOrder(const int* from, const int* to, size_t n, unsigned threads = hardwareThreads()) {
+    std::vector<std::pair<uint64_t, int>> items(n), buffer(n);
+    parallelFor(n, threads, [&](size_t begin, size_t end, unsigned) {
+        for (size_t k = begin; k < end; ++k) items[k] = {edgeKey(from[k], to[k]), static_cast<int>(k)};
+    });
+
+    threads = std::max(1u, std::min<unsigned>(threads, n / 4096 + 1));
+    std::vector<std::array<size_t, 256>> counts(threads);
+    for (int shift = 0; shift < 64; shift += 8) {
+        parallelFor(n, threads, [&](size_t begin, size_t end, unsigned t) {
+            counts[t].fill(0);
+            for (size_t k = begin; k < end; ++k) ++counts[t][(items[k].first >> shift) & 0xff];
+        });
+
+        // Разряд одинаков у всех ключей — проход не нужен
+        bool trivial = false;
+        for (int digit = 0; digit < 256 && !trivial; ++digit) {
+            size_t total = 0;
+            for (unsigned t = 0; t < threads; ++t) total += counts[t][digit];
+            trivial = total == n;
+        }
+        if (trivial) continue;
+
+        // Начало области каждого потока для каждого значения разряда
+        size_t offset = 0;
+        for (int digit = 0; digit < 256; ++digit) {
+            for (unsigned t = 0; t < threads; ++t) {
+                size_t count = counts[t][digit];
+                counts[t][digit] = offset;
+                offset += count;
+            }
+        }
+        parallelFor(n, threads, [&](size_t begin, size_t end, unsigned t) {
+            for (size_t k = begin; k < end; ++k) buffer[counts[t][(items[k].first >> shift) & 0xff]++] = items[k];
+        });
+        items.swap(buffer);
+    }
+
+    std::vector<int> order(n);
+    for (size_t k = 0; k < n; ++k) order[k] = items[k].second;
+    return order;
+}
+
+// Счётчики внутренней работы операций графа. Считаются только при сборке с GRAPH_STATS,
+// без него GRAPH_COUNT раскрывается в пустое выражение и аргументы не вычисляются
+enum class GraphCounter {
+    ChainSteps, // Шаги по цепочкам пучков H/L
+    ListNodes, // Посещённые узлы std::list
+    ShiftedElements, // Элементы массивов, сдвинутые при erase
+    RenumberedLinks, // Ссылки H/L, просмотренные при перенумерации после удаления дуги
+    HashProbes, // Элементы просмотренных корзин хеш-таблиц
+    ScannedEdges, // Дуги, просмотренные линейным поиском
+    Count
+};
+
+using GraphStatsSnapshot = std::array<uint64_t, static_cast<size_t>(GraphCounter::Count)>;
+
+// Потоковые счётчики: каждый поток пишет в свой блок без блокировок,
+// снимок суммирует живые блоки и итоги завершившихся потоков
+class GraphStats {
+public:
+#ifdef GRAPH_STATS
+    static constexpr bool enabled = true;
+#else
+    static constexpr bool enabled = false;
+#endif
+
+    static constexpr std::array<const char*, static_cast<size_t>(GraphCounter::Count)> names = {
+            "chain_steps", "list_nodes", "shifted_elements", "renumbered_links", "hash_probes", "scanned_edges"};
+
+    static void add(GraphCounter counter, uint64_t n) {
+        std::atomic<uint64_t>& value = local().counts[static_cast<size_t>(counter)];
+        value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    // Сумма счётчиков всех потоков
+    static GraphStatsSnapshot snapshot() {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        GraphStatsSnapshot total = r.retired;
+        for (const ThreadCounters* counters : r.live) {
+            for (size_t k = 0; k < total.size(); ++k) total[k] += counters->counts[k].load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+    static void reset() {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        r.retired.fill(0);
+        for (ThreadCounters* counters : r.live) {
+            for (auto& value : counters->counts) value.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    // Выгрузка снимка в текстовом формате "graph_<счётчик> <значение>" по строке на счётчик
+    static std::string exportText(const GraphStatsSnapshot& stats) {
+        std::string text;
+        for (size_t k = 0; k < stats.size(); ++k) {
+            text += std::string("graph_") + names[k] + " " + std::to_string(stats[k]) + "\n";
+        }
+        return text;
+    }
+
+    // Разность снимков: работа, выполненная между ними
+    static GraphStatsSnapshot difference(const GraphStatsSnapshot& after, const GraphStatsSnapshot& before) {
+        GraphStatsSnapshot delta;
+        for (size_t k = 0; k < delta.size(); ++k) delta[k] = after[k] - before[k];
+        return delta;
+    }
+
+private:
+    struct ThreadCounters;
+
+    struct Registry {
+        std::mutex mutex;
+        std::vector<ThreadCounters*> live;
+        GraphStatsSnapshot retired{};
+    };
+
+    struct ThreadCounters {
+        std::array<std::atomic<uint64_t>, static_cast<size_t>(GraphCounter::Count)> counts{};
+
+        ThreadCounters() {
+            Registry& r = registry();
+            std::lock_guard<std::mutex> lock(r.mutex);
+            r.live.push_back(this);
+        }
+
+        ~ThreadCounters() {
+            Registry& r = registry();
+            std::lock_guard<std::mutex> lock(r.mutex);
+            for (size_t k = 0; k < counts.size(); ++k) r.retired[k] += counts[k].load(std::memory_order_relaxed);
+            r.live.erase(std::find(r.live.begin(), r.live.end(), this));
+        }
+    };
+
+    static Registry& registry() {
+        static Registry r;
+        return r;
+    }
+
+    static ThreadCounters& local() {
+        thread_local ThreadCounters counters;
+        return counters;
+    }
+};
+
+#ifdef GRAPH_STATS
+#define GRAPH_COUNT(counter, n) GraphStats::add(GraphCounter::counter, (n))
+#else
+#define GRAPH_COUNT(counter, n) ((void)0)
+#endif
+
+// Длина корзины хеш-таблицы, в которую попадает ключ (не меньше одного сравнения)
+template<class Table, class Key>
+uint64_t bucketLength(const Table& table, const Key& key) {
+    return std::max<size_t>(1, table.bucket_size(table.bucket(key)));
+}
+
+// Типизированные столбцы свойств (структура массивов), выровненные со слотами дуг или номерами вершин
+class PropertyColumns {
+public:
+    PropertyColumns() = default;
+
+    PropertyColumns(const PropertyColumns& other) : rows(other.rows) {
+        for (const auto& column : other.columns) columns.push_back(column->clone());
+    }
+
+    PropertyColumns& operator=(const PropertyColumns& other) {
+        if (this != &other) {
+            PropertyColumns copy(other);
+            std::swap(columns, copy.columns);
+            rows = other.rows;
+        }
+        return *this;
+    }
+
+    PropertyColumns(PropertyColumns&&) = default;
+    PropertyColumns& operator=(PropertyColumns&&) = default;
+
+    // Регистрация столбца; существующие строки заполняются значением по умолчанию
+    template<class T>
+    int addColumn(const std::string& name, T defaultValue = T()) {
+        auto column = std::make_unique<Column<T>>();
+        column->name = name;
+        column->defaultValue = defaultValue;
+        column->values.assign(rows, defaultValue);
+        columns.push_back(std::move(column));
+        return columns.size() - 1;
+    }
+
+    // Поиск столбца по имени (возвращает номер или -1)
+    int findColumn(const std::string& name) const {
+        for (size_t c = 0; c < columns.size(); ++c) {
+            if (columns[c]->name == name) return c;
+        }
+        return -1;
+    }
+
+    // Значения столбца: сплошной массив, по одному значению на строку
+    template<class T>
+    std::vector<T>& column(int id) {
+        auto* typed = dynamic_cast<Column<T>*>(columns.at(id).get());
+        if (!typed) throw std::invalid_argument("Property column type mismatch");
+        return typed->values;
+    }
+
+    template<class T>
+    const std::vector<T>& column(int id) const {
+        return const_cast<PropertyColumns*>(this)->column<T>(id);
+    }
+
+    size_t size() const {
+        return rows;
+    }
+
+    // Изменение числа строк во всех столбцах
+    void resize(size_t n) {
+        rows = n;
+        for (auto& column : columns) column->resize(n);
+    }
+
+    // Добавление строки со значениями по умолчанию
+    void pushBack() {
+        resize(rows + 1);
+    }
+
+    // Удаление строки со сдвигом, как у массивов дуг
+    void erase(size_t index) {
+        --rows;
+        for (auto& column : columns) column->erase(index);
+    }
+
+    // Выборка строк: новая строка k — старая строка order[k]
+    void select(const std::vector<int>& order) {
+        rows = order.size();
+        for (auto& column : columns) column->select(order);
+    }
+
+    // Обмен двух строк
+    void swapRows(size_t a, size_t b) {
+        for (auto& column : columns) column->swapRows(a, b);
+    }
+
+    // Новые столбцы из выбранных строк: строка k — строка order[k]; остальные строки не копируются
+    PropertyColumns selected(const std::vector<int>& order) const {
+        PropertyColumns result;
+        result.rows = order.size();
+        for (const auto& column : columns) result.columns.push_back(column->cloneRows(order));
+        return result;
+    }
+
+private:
+    struct ColumnBase {
+        std::string name;
+        virtual ~ColumnBase() = default;
+        virtual void resize(size_t n) = 0;
+        virtual void erase(size_t index) = 0;
+        virtual void select(const std::vector<int>& order) = 0;
+        virtual void swapRows(size_t a, size_t b) = 0;
+        virtual std::unique_ptr<ColumnBase> clone() const = 0;
+        virtual std::unique_ptr<ColumnBase> cloneRows(const std::vector<int>& order) const = 0;
+    };
+
+    template<class T>
+    struct Column : ColumnBase {
+        std::vector<T> values;
+        T defaultValue;
+
+        void resize(size_t n) override {
+            values.resize(n, defaultValue);
+        }
+
+        void erase(size_t index) override {
+            values.erase(values.begin() + index);
+        }
+
+        void select(const std::vector<int>& order) override {
+            std::vector<T> selected;
+            selected.reserve(order.size());
+            for (int k : order) selected.push_back(values[k]);
+            values.swap(selected);
+        }
+
+        void swapRows(size_t a, size_t b) override {
+            T value = values[a];
+            values[a] = values[b];
+            values[b] = value;
+        }
+
+        std::unique_ptr<ColumnBase> clone() const override {
+            return std::make_unique<Column<T>>(*this);
+        }
+
+        std::unique_ptr<ColumnBase> cloneRows(const std::vector<int>& order) const override {
+            auto copy = std::make_unique<Column<T>>();
+            copy->name = name;
+            copy->defaultValue = defaultValue;
+            copy->values.reserve(order.size());
+            for (int k : order) copy->values.push_back(values[k]);
+            return copy;
+        }
+    };
+
+    std::vector<std::unique_ptr<ColumnBase>> columns;
+    size_t rows = 0;
+};
+
+// Счётный фильтр Блума на дугах (from, to): все счётчики одной дуги лежат в одной линии кэша.
+// Отрицательный ответ точен, поэтому поиск отсутствующей дуги не обходит структуру графа
+class EdgeFilter {
+public:
+    explicit EdgeFilter(size_t expectedEdges)
+            : capacityEdges(std::max<size_t>(expectedEdges, 1024)), blocks(capacityEdges * 10 / 128 + 1) {}
+
+    // Учёт дуги; false — фильтр переполнен и его стоит перестроить большего размера
+    bool insert(int from, int to) {
+        forEachCounter(from, to, [](Block& b, int c) {
+            int value = counter(b, c);
+            if (value < 15) setCounter(b, c, value + 1);
+        });
+        return ++count <= capacityEdges;
+    }
+
+    // Снятие дуги; насыщенные счётчики не уменьшаются, чтобы не было ложных отрицаний
+    void remove(int from, int to) {
+        forEachCounter(from, to, [](Block& b, int c) {
+            int value = counter(b, c);
+            if (value > 0 && value < 15) setCounter(b, c, value - 1);
+        });
+        --count;
+    }
+
+    // false — дуги точно нет
+    bool mayContain(int from, int to) const {
+        bool present = true;
+        const_cast<EdgeFilter*>(this)->forEachCounter(from, to, [&](Block& b, int c) {
+            present = present && counter(b, c) != 0;
+        });
+        return present;
+    }
+
+    size_t capacity() const {
+        return capacityEdges;
+    }
+
+private:
+    // 128 четырёхбитных счётчиков в 64 байтах
+    struct alignas(64) Block {
+        uint8_t nibbles[64] = {};
+    };
+
+    size_t capacityEdges;
+    std::vector<Block> blocks;
+    size_t count = 0;
+
+    static int counter(const Block& b, int c) {
+        return (b.nibbles[c >> 1] >> ((c & 1) * 4)) & 15;
+    }
+
+    static void setCounter(Block& b, int c, int value) {
+        int shift = (c & 1) * 4;
+        b.nibbles[c >> 1] = static_cast<uint8_t>((b.nibbles[c >> 1] & ~(15 << shift)) | (value << shift));
+    }
+
+    // Четыре счётчика дуги в блоке, выбранном по старшим битам хеша
+    template<class F>
+    void forEachCounter(int from, int to, F f) {
+        uint64_t h = edgeKey(from, to) + 0x9e3779b97f4a7c15ull;
+        h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ull;
+        h = (h ^ (h >> 27)) * 0x94d049bb133111ebull;
+        h ^= h >> 31;
+        Block& b = blocks[(h >> 32) % blocks.size()];
+        for (int i = 0; i < 4; ++i) f(b, (h >> (7 * i)) & 127);
+    }
+};
+
+// Ядра линейного просмотра столбцов I/J: скалярные и векторные (AVX2, AVX-512) с выбором при запуске
+struct ScanKernels {
+    size_t (*findPair)(const int* I, const int* J, size_t n, int a, int b); // Первый k: I[k] == a && J[k] == b, иначе n
+    void (*collectPairs)(const int* I, const int* J, size_t n, int a, int b, std::vector<int>& out);
+    void (*collectIncident)(const int* I, const int* J, size_t n, int v, std::vector<int>& out); // I[k] == v || J[k] == v
+    size_t (*countEqual)(const int* X, size_t n, int v);
+};
+
+size_t findPairScalar(const int* I, const int* J, size_t n, int a, int b) {
+    for (size_t k = 0; k < n; ++k) {
+        if (I[k] == a && J[k] == b) return k;
+    }
+    return n;
+}
+
+void collectPairsScalar(const int* I, const int* J, size_t n, int a, int b, std::vector<int>& out) {
+    for (size_t k = 0; k < n; ++k) {
+        if (I[k] == a && J[k] == b) out.push_back(k);
+    }
+}
+
+void collectIncidentScalar(const int* I, const int* J, size_t n, int v, std::vector<int>& out) {
+    for (size_t k = 0; k < n; ++k) {
+        if (I[k] == v || J[k] == v) out.push_back(k);
+    }
+}
+
+size_t countEqualScalar(const int* X, size_t n, int v) {
+    size_t count = 0;
+    for (size_t k = 0; k < n; ++k) count += X[k] == v;
+    return count;
+}
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define GRAPH_X86_KERNELS 1
+
+// Запись номеров установленных битов маски
+inline void appendMask(uint32_t mask, size_t base, std::vector<int>& out) {
+    for (; mask; mask &= mask - 1) out.push_back(base + __builtin_ctz(mask));
+}
+
+__attribute__((target("avx2")))
+size_t findPairAvx2(const int* I, const int* J, size_t n, int a, int b) {
+    __m256i va = _mm256_set1_epi32(a), vb = _mm256_set1_epi32(b);
+    size_t k = 0;
+    for (; k + 8 <= n; k += 8) {
+        __m256i eq = _mm256_and_si256(_mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i*) (I + k)), va),
+                                      _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i*) (J + k)), vb));
+        int mask = _mm256_movemask_ps(_mm256_castsi256_ps(eq));
+        if (mask) return k + __builtin_ctz(mask);
+    }
+    size_t tail = findPairScalar(I + k, J + k, n - k, a, b);
+    return k + tail;
+}
+
+__attribute__((target("avx2")))
+void collectPairsAvx2(const int* I, const int* J, size_t n, int a, int b, std::vector<int>& out) {
+    __m256i va = _mm256_set1_epi32(a), vb = _mm256_set1_epi32(b);
+    size_t k = 0;
+    for (; k + 8 <= n; k += 8) {
+        __m256i eq = _mm256_and_si256(_mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i*) (I + k)), va),
+                                      _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i*) (J + k)), vb));
+        appendMask(_mm256_movemask_ps(_mm256_castsi256_ps(eq)), k, out);
+    }
+    for (; k < n; ++k) {
+        if (I[k] == a && J[k] == b) out.push_back(k);
+    }
+}
+
+__attribute__((target("avx2")))
+void collectIncidentAvx2(const int* I, const int* J, size_t n, int v, std::vector<int>& out) {
+    __m256i vv = _mm256_set1_epi32(v);
+    size_t k = 0;
+    for (; k + 8 <= n; k += 8) {
+        __m256i eq = _mm256_or_si256(_mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i*) (I + k)), vv),
+                                     _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i*) (J + k)), vv));
+        appendMask(_mm256_movemask_ps(_mm256_castsi256_ps(eq)), k, out);
+    }
+    for (; k < n; ++k) {
+        if (I[k] == v || J[k] == v) out.push_back(k);
+    }
+}
+
+__attribute__((target("avx2")))
+size_t countEqualAvx2(const int* X, size_t n, int v) {
+    __m256i vv = _mm256_set1_epi32(v);
+    size_t count = 0, k = 0;
+    while (k + 8 <= n) {
+        // Счётчики в 32-битных полосах; сброс каждые 2^30 элементов исключает переполнение
+        __m256i acc = _mm256_setzero_si256();
+        size_t end = std::min(n - (n - k) % 8, k + (size_t(1) << 30));
+        for (; k < end; k += 8) {
+            acc = _mm256_sub_epi32(acc, _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i*) (X + k)), vv));
+        }
+        alignas(32) uint32_t lanes[8];
+        _mm256_store_si256((__m256i*) lanes, acc);
+        for (uint32_t lane : lanes) count += lane;
+    }
+    return count + countEqualScalar(X + k, n - k, v);
+}
+
+__attribute__((target("avx512f")))
+size_t findPairAvx512(const int* I, const int* J, size_t n, int a, int b) {
+    __m512i va = _mm512_set1_epi32(a), vb = _mm512_set1_epi32(b);
+    size_t k = 0;
+    for (; k + 16 <= n; k += 16) {
+        __mmask16 mask = _mm512_mask_cmpeq_epi32_mask(_mm512_cmpeq_epi32_mask(_mm512_loadu_si512(I + k), va),
+                                                      _mm512_loadu_si512(J + k), vb);
+        if (mask) return k + __builtin_ctz(mask);
+    }
+    return k + findPairScalar(I + k, J + k, n - k, a, b);
+}
+
+__attribute__((target("avx512f")))
+void collectPairsAvx512(const int* I, const int* J, size_t n, int a, int b, std::vector<int>& out) {
+    __m512i va = _mm512_set1_epi32(a), vb = _mm512_set1_epi32(b);
+    size_t k = 0;
+    for (; k + 16 <= n; k += 16) {
+        appendMask(_mm512_mask_cmpeq_epi32_mask(_mm512_cmpeq_epi32_mask(_mm512_loadu_si512(I + k), va),
+                                                _mm512_loadu_si512(J + k), vb), k, out);
+    }
+    for (; k < n; ++k) {
+        if (I[k] == a && J[k] == b) out.push_back(k);
+    }
+}
+
+__attribute__((target("avx512f")))
+void collectIncidentAvx512(const int* I, const int* J, size_t n, int v, std::vector<int>& out) {
+    __m512i vv = _mm512_set1_epi32(v);
+    size_t k = 0;
+    for (; k + 16 <= n; k += 16) {
+        appendMask(_mm512_cmpeq_epi32_mask(_mm512_loadu_si512(I + k), vv) |
+                   _mm512_cmpeq_epi32_mask(_mm512_loadu_si512(J + k), vv), k, out);
+    }
+    for (; k < n; ++k) {
+        if (I[k] == v || J[k] == v) out.push_back(k);
+    }
+}
+
+__attribute__((target("avx512f")))
+size_t countEqualAvx512(const int* X, size_t n, int v) {
+    __m512i vv = _mm512_set1_epi32(v);
+    size_t count = 0, k = 0;
+    for (; k + 16 <= n; k += 16) {
+        count += __builtin_popcount(_mm512_cmpeq_epi32_mask(_mm512_loadu_si512(X + k), vv));
+    }
+    return count + countEqualScalar(X + k, n - k, v);
+}
+#endif
+
+// Лучший набор ядер для текущего процессора
+const ScanKernels& scanKernels() {
+    static const ScanKernels kernels = [] {
+#ifdef GRAPH_X86_KERNELS
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f")) {
+            return ScanKernels{findPairAvx512, collectPairsAvx512, collectIncidentAvx512, countEqualAvx512};
+        }
+        if (__builtin_cpu_supports("avx2")) {
+            return ScanKernels{findPairAvx2, collectPairsAvx2, collectIncidentAvx2, countEqualAvx2};
+        }
+#endif
+        return ScanKernels{findPairScalar, collectPairsScalar, collectIncidentScalar, countEqualScalar};
+    }();
+    return kernels;
+}
+
+// Ядра пакетного декодирования сжатых весов в float и сумм весов отрезков:
+// скалярные и AVX2 (с F16C) с выбором при запуске
+struct WeightKernels {
+    void (*decodeHalf)(const uint16_t* in, size_t n, float* out);
+    void (*decodeBFloat16)(const uint16_t* in, size_t n, float* out);
+    void (*decodeCodebook)(const uint8_t* in, size_t n, const float* codebook, float* out);
+    // Суммы [offsets[v], offsets[v + 1]) для v < segments: весь проход — один вызов
+    void (*sumSegmentsHalf)(const uint16_t* in, const int* offsets, size_t segments, double* out);
+    void (*sumSegmentsBFloat16)(const uint16_t* in, const int* offsets, size_t segments, double* out);
+    bool f16c; // Доступны ли AVX2 и F16C для встраиваемых ядер обхода
+};
+
+// Половинная точность IEEE 754 (1 + 5 + 10 бит) в float
+inline float halfToFloat(uint16_t h) {
+    uint32_t sign = static_cast<uint32_t>(h & 0x8000) << 16;
+    uint32_t exponent = (h >> 10) & 0x1f, mantissa = h & 0x3ff;
+    uint32_t bits;
+    if (exponent == 0x1f) {
+        bits = sign | 0x7f800000u | (mantissa << 13);
+    } else if (exponent != 0) {
+        bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    } else if (mantissa == 0) {
+        bits = sign;
+    } else {
+        // Денормализованное число: нормализация мантиссы
+        int shift = 0;
+        while ((mantissa & 0x400) == 0) {
+            mantissa <<= 1;
+            ++shift;
+        }
+        bits = sign | ((113 - shift) << 23) | ((mantissa & 0x3ff) << 13);
+    }
+    float value;
+    std::memcpy(&value, &bits, 4);
+    return value;
+}
+
+// float в половинную точность с округлением к ближайшему чётному
+inline uint16_t floatToHalf(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, 4);
+    uint16_t sign = (bits >> 16) & 0x8000;
+    uint32_t magnitude = bits & 0x7fffffffu;
+    if (magnitude >= 0x7f800000u) return sign | 0x7c00 | (magnitude > 0x7f800000u ? 0x200 : 0); // Inf, NaN
+    if (magnitude >= 0x477ff000u) return sign | 0x7c00; // Переполнение
+    if (magnitude < 0x38800000u) {
+        // Денормализованный результат
+        if (magnitude < 0x33000000u) return sign;
+        uint32_t mantissa = (magnitude & 0x7fffff) | 0x800000;
+        int shift = 126 - (magnitude >> 23);
+        uint32_t half = mantissa >> shift, rest = mantissa & ((1u << shift) - 1), middle = 1u << (shift - 1);
+        if (rest > middle || (rest == middle && (half & 1))) ++half;
+        return sign | half;
+    }
+    uint32_t rounded = magnitude + 0xfff + ((magnitude >> 13) & 1);
+    return sign | static_cast<uint16_t>((rounded - 0x38000000u) >> 13);
+}
+
+// float в bfloat16 (старшие 16 бит) с округлением к ближайшему чётному
+inline uint16_t floatToBFloat16(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, 4);
+    if ((bits & 0x7fffffffu) > 0x7f800000u) return (bits >> 16) | 0x40; // NaN остаётся NaN
+    return (bits + 0x7fff + ((bits >> 16) & 1)) >> 16;
+}
+
+// bfloat16 в float: старшие 16 бит
+inline float bfloat16ToFloat(uint16_t b) {
+    uint32_t bits = static_cast<uint32_t>(b) << 16;
+    float value;
+    std::memcpy(&value, &bits, 4);
+    return value;
+}
+
+void decodeHalfScalar(const uint16_t* in, size_t n, float* out) {
+    for (size_t k = 0; k < n; ++k) out[k] = halfToFloat(in[k]);
+}
+
+void decodeBFloat16Scalar(const uint16_t* in, size_t n, float* out) {
+    for (size_t k = 0; k < n; ++k) out[k] = bfloat16ToFloat(in[k]);
+}
+
+// Суммы отрезков четырьмя независимыми накопителями: цепочка сложений не ограничивает проход
+template<class T, class Decode>
+void sumSegmentsScalar(const T* in, const int* offsets, size_t segments, double* out, Decode decode) {
+    for (size_t v = 0; v < segments; ++v) {
+        double sum[4] = {0, 0, 0, 0};
+        int k = offsets[v], end = offsets[v + 1];
+        for (; k + 4 <= end; k += 4) {
+            for (int j = 0; j < 4; ++j) sum[j] += decode(in[k + j]);
+        }
+        for (; k < end; ++k) sum[0] += decode(in[k]);
+        out[v] = (sum[0] + sum[1]) + (sum[2] + sum[3]);
+    }
+}
+
+void sumSegmentsHalfScalar(const uint16_t* in, const int* offsets, size_t segments, double* out) {
+    sumSegmentsScalar(in, offsets, segments, out, halfToFloat);
+}
+
+void sumSegmentsBFloat16Scalar(const uint16_t* in, const int* offsets, size_t segments, double* out) {
+    sumSegmentsScalar(in, offsets, segments, out, bfloat16ToFloat);
+}
+
+// Обход весов [begin, end) с декодированием в цикле: f(индекс, вес). Шаблонные ядра встраиваются
+// в обход вместе с f — без вызова через указатель и промежуточного буфера
+template<class F>
+void sweepHalfScalar(const uint16_t* in, size_t begin, size_t end, F& f) {
+    for (size_t k = begin; k < end; ++k) f(k, halfToFloat(in[k]));
+}
+
+void decodeCodebookScalar(const uint8_t* in, size_t n, const float* codebook, float* out) {
+    for (size_t k = 0; k < n; ++k) out[k] = codebook[in[k]];
+}
+
+#ifdef GRAPH_X86_KERNELS
+// Перед скалярным хвостом старшие половины регистров обнуляются явно:
+// иначе переход в SSE-код при хвостовом вызове платит за смену состояния AVX
+__attribute__((target("avx2,f16c")))
+void decodeHalfAvx2(const uint16_t* in, size_t n, float* out) {
+    size_t k = 0;
+    for (; k + 8 <= n; k += 8) {
+        _mm256_storeu_ps(out + k, _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*) (in + k))));
+    }
+    _mm256_zeroupper();
+    decodeHalfScalar(in + k, n - k, out + k);
+}
+
+__attribute__((target("avx2")))
+void decodeBFloat16Avx2(const uint16_t* in, size_t n, float* out) {
+    size_t k = 0;
+    for (; k + 8 <= n; k += 8) {
+        __m256i wide = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*) (in + k)));
+        _mm256_storeu_si256((__m256i*) (out + k), _mm256_slli_epi32(wide, 16));
+    }
+    _mm256_zeroupper();
+    decodeBFloat16Scalar(in + k, n - k, out + k);
+}
+
+__attribute__((target("avx2")))
+void decodeCodebookAvx2(const uint8_t* in, size_t n, const float* codebook, float* out) {
+    size_t k = 0;
+    for (; k + 8 <= n; k += 8) {
+        uint64_t codes;
+        std::memcpy(&codes, in + k, 8);
+        __m256i index = _mm256_cvtepu8_epi32(_mm_cvtsi64_si128(codes));
+        _mm256_storeu_ps(out + k, _mm256_i32gather_ps(codebook, index, 4));
+    }
+    _mm256_zeroupper();
+    decodeCodebookScalar(in + k, n - k, codebook, out + k);
+}
+
+// Восемь float прибавляются к двум накопителям double
+__attribute__((target("avx2")))
+inline void addAsDoubles(__m256 w, __m256d& low, __m256d& high) {
+    low = _mm256_add_pd(low, _mm256_cvtps_pd(_mm256_castps256_ps128(w)));
+    high = _mm256_add_pd(high, _mm256_cvtps_pd(_mm256_extractf128_ps(w, 1)));
+}
+
+__attribute__((target("avx2")))
+inline double horizontalSum(__m256d low, __m256d high) {
+    alignas(32) double lanes[4];
+    _mm256_store_pd(lanes, _mm256_add_pd(low, high));
+    return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+}
+
+__attribute__((target("avx2,f16c")))
+void sumSegmentsHalfAvx2(const uint16_t* in, const int* offsets, size_t segments, double* out) {
+    for (size_t v = 0; v < segments; ++v) {
+        int k = offsets[v], end = offsets[v + 1];
+        __m256d low = _mm256_setzero_pd(), high = _mm256_setzero_pd();
+        for (; k + 8 <= end; k += 8) addAsDoubles(_mm256_cvtph_ps(_mm_loadu_si128((const __m128i*) (in + k))), low, high);
+        double sum = horizontalSum(low, high);
+        for (; k < end; ++k) sum += _cvtsh_ss(in[k]);
+        out[v] = sum;
+    }
+}
+
+__attribute__((target("avx2")))
+void sumSegmentsBFloat16Avx2(const uint16_t* in, const int* offsets, size_t segments, double* out) {
+    for (size_t v = 0; v < segments; ++v) {
+        int k = offsets[v], end = offsets[v + 1];
+        __m256d low = _mm256_setzero_pd(), high = _mm256_setzero_pd();
+        for (; k + 8 <= end; k += 8) {
+            __m256i wide = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*) (in + k)));
+            addAsDoubles(_mm256_castsi256_ps(_mm256_slli_epi32(wide, 16)), low, high);
+        }
+        double sum = horizontalSum(low, high);
+        for (; k < end; ++k) sum += bfloat16ToFloat(in[k]);
+        out[v] = sum;
+    }
+}
+
+template<class F>
+__attribute__((target("avx2,f16c")))
+void sweepHalfAvx2(const uint16_t* in, size_t begin, size_t end, F& f) {
+    size_t k = begin;
+    for (; k + 8 <= end; k += 8) {
+        alignas(32) float decoded[8];
+        _mm256_store_ps(decoded, _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*) (in + k))));
+        for (int j = 0; j < 8; ++j) f(k + j, decoded[j]);
+    }
+    for (; k < end; ++k) f(k, _cvtsh_ss(in[k]));
+}
+#endif
+
+// Лучший набор ядер декодирования для текущего процессора
+const WeightKernels& weightKernels() {
+    static const WeightKernels kernels = [] {
+#ifdef GRAPH_X86_KERNELS
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("f16c")) {
+            return WeightKernels{decodeHalfAvx2, decodeBFloat16Avx2, decodeCodebookAvx2, sumSegmentsHalfAvx2,
+                                 sumSegmentsBFloat16Avx2, true};
+        }
+#endif
+        return WeightKernels{decodeHalfScalar, decodeBFloat16Scalar, decodeCodebookScalar, sumSegmentsHalfScalar,
+                             sumSegmentsBFloat16Scalar, false};
+    }();
+    return kernels;
+}
+
+// Политика обработки кратных дуг (from, to) при пакетной загрузке
+enum class DuplicatePolicy {
+    KeepAll,    // Оставить все дуги
+    KeepFirst,  // Оставить первую дугу
+    SumWeights, // Одна дуга с суммой весов
+    MinWeight   // Одна дуга с наименьшим весом
+};
+
+// Проверка пакета дуг для insertEdges: массивы концов и весов одной длины
+inline void checkEdgeBatch(const std::vector<int>& from, const std::vector<int>& to, const std::vector<double>& weight) {
+    if (from.size() != to.size() || from.size() != weight.size()) {
+        throw std::invalid_argument("insertEdges: from, to and weight sizes differ");
+    }
+}
+
+// Слияние кратных дуг по политике; при слиянии дуги упорядочиваются по (from, to)
+// Свойства слитой дуги берутся у первой дуги группы
+template<class IntArray, class WeightArray>
+void coalesceEdges(IntArray& I, IntArray& J, WeightArray& weights,
+                   DuplicatePolicy policy, PropertyColumns* properties = nullptr,
+                   unsigned threads = hardwareThreads()) {
+    if (policy == DuplicatePolicy::KeepAll) return;
+
+    std::vector<int> order = sortedEdgeOrder(I.data(), J.data(), I.size(), threads);
+    IntArray newI, newJ;
+    std::vector<int> kept;
+    WeightArray newWeights;
+    for (size_t k = 0; k < order.size(); ++k) {
+        int e = order[k];
+        if (k > 0 && I[e] == newI.back() && J[e] == newJ.back()) {
+            if (policy == DuplicatePolicy::SumWeights) {
+                newWeights.back() += weights[e];
+            } else if (policy == DuplicatePolicy::MinWeight) {
+                newWeights.back() = std::min(newWeights.back(), weights[e]);
+            }
+            continue;
+        }
+        newI.push_back(I[e]);
+        newJ.push_back(J[e]);
+        newWeights.push_back(weights[e]);
+        kept.push_back(e);
+    }
+    I.swap(newI);
+    J.swap(newJ);
+    weights.swap(newWeights);
+    if (properties) properties->select(kept);
+}
+
+// Список дуг. Allocator — аллокатор массивов I, J, weights: по умолчанию std::allocator
+// (обычные std::vector), GraphAllocator — большие страницы по graphPagePolicy()
+template<template<class> class Allocator = std::allocator>
+class BasicEdgeListGraph {
+public:
+    template<class T>
+    using Array = std::vector<T, Allocator<T>>;
+
+    Array<int> I; // Начальные вершины
+    Array<int> J; // Конечные вершины
+    Array<double> weights; // Вес дуг
+    std::unordered_set<int> vertices; // Набор для хранения уникальных вершин
+    bool undirected = false; // Неориентированный граф: ребро хранится один раз как (min, max)
+    PropertyColumns edgeProperties; // Свойства дуг, строка k — дуга k
+    PropertyColumns vertexProperties; // Свойства вершин, строка v — вершина v (v >= 0)
+    std::optional<EdgeFilter> edgeFilter; // Фильтр отсутствующих дуг (необязательный)
+
+    explicit BasicEdgeListGraph(bool undirected = false) : undirected(undirected) {}
+
+    // Включение фильтра отсутствующих дуг перед findEdge
+    void enableEdgeFilter(size_t expectedEdges = 0) {
+        edgeFilter.emplace(std::max(expectedEdges, I.size()));
+        forEachEdge([&](int from, int to, double) { edgeFilter->insert(from, to); });
+    }
+
+    // Вставка вершины
+    void insertVertex(int vertex) {
+        GRAPH_COUNT(HashProbes, bucketLength(vertices, vertex));
+        vertices.insert(vertex);
+        if (vertex >= static_cast<int>(vertexProperties.size())) {
+            vertexProperties.resize(vertex + 1);
+        }
+    }
+
+    // Вставка дуги
+    void insertEdge(int from, int to, double weight) {
+        canonicalize(from, to);
+        I.push_back(from);
+        J.push_back(to);
+        weights.push_back(weight);
+        edgeProperties.pushBack();
+        if (edgeFilter && !edgeFilter->insert(from, to)) enableEdgeFilter(2 * edgeFilter->capacity());
+        // Убедимся, что вершины также добавлены
+        insertVertex(from);
+        insertVertex(to);
+        if (sorted && I.size() - sortedCount > mergeThreshold()) mergeTail();
+    }
+
+    // Пакетная вставка дуг со слиянием кратных дуг всего графа по политике
+    void insertEdges(const std::vector<int>& from, const std::vector<int>& to, const std::vector<double>& weight,
+                     DuplicatePolicy policy = DuplicatePolicy::KeepAll) {
+        checkEdgeBatch(from, to, weight);
+        I.insert(I.end(), from.begin(), from.end());
+        J.insert(J.end(), to.begin(), to.end());
+        weights.insert(weights.end(), weight.begin(), weight.end());
+        edgeProperties.resize(I.size());
+        for (size_t k = I.size() - from.size(); k < I.size(); ++k) {
+            canonicalize(I[k], J[k]);
+            insertVertex(I[k]);
+            insertVertex(J[k]);
+        }
+        coalesceEdges(I, J, weights, policy, &edgeProperties);
+        if (edgeFilter) enableEdgeFilter(2 * I.size());
+        if (policy != DuplicatePolicy::KeepAll) {
+            // После слияния дуги уже упорядочены по (I, J)
+            sorted = true;
+            sortedCount = I.size();
+        } else if (sorted && I.size() - sortedCount > mergeThreshold()) {
+            mergeTail();
+        }
+    }
+
+    // Упорядочение дуг по (I, J) параллельной поразрядной сортировкой; включает режим упорядоченного списка
+    void sortEdges(unsigned threads = hardwareThreads()) {
+        permuteEdges(sortedEdgeOrder(I.data(), J.data(), I.size(), threads));
+        sorted = true;
+        sortedCount = I.size();
+    }
+
+    // Включён ли режим упорядоченного списка
+    bool isSorted() const {
+        return sorted;
+    }
+
+    // Дуги вершины в упорядоченной части: отрезок индексов [first, second)
+    std::pair<int, int> sourceRange(int from) const {
+        return {lowerBound(edgeKey(from, INT_MIN)), lowerBound(edgeKey(from, INT_MAX) + 1)};
+    }
+
+    // Удаление вершины и всех её инцидентных рёбер
+    void removeVertex(int vertex) {
+        // Удаляем рёбра, где вершина выступает как начальная или конечная
+        std::vector<int> incident;
+        GRAPH_COUNT(ScannedEdges, I.size());
+        scanKernels().collectIncident(I.data(), J.data(), I.size(), vertex, incident);
+        eraseEdges(incident);
+        // Удаляем вершину
+        vertices.erase(vertex);
+    }
+
+    // Удаление дуги по индексу
+    void removeEdge(int index) {
+        if (index >= 0 && index < I.size()) {
+            if (edgeFilter) edgeFilter->remove(I[index], J[index]);
+            if (index < static_cast<int>(sortedCount)) --sortedCount;
+            GRAPH_COUNT(ShiftedElements, 3 * (I.size() - index - 1));
+            I.erase(I.begin() + index);
+            J.erase(J.begin() + index);
+            weights.erase(weights.begin() + index);
+            edgeProperties.erase(index);
+        }
+    }
+
+    // Удаление дуги по вершинам (удаляет все дуги с данными вершинами)
+    void removeEdge(int from, int to) {
+        canonicalize(from, to);
+        if (edgeFilter && !edgeFilter->mayContain(from, to)) return;
+        std::vector<int> matches;
+        int first = lowerBound(edgeKey(from, to)), last = lowerBound(edgeKey(from, to) + 1);
+        for (int k = first; k < last; ++k) matches.push_back(k);
+        std::vector<int> tail;
+        GRAPH_COUNT(ScannedEdges, I.size() - sortedCount);
+        scanKernels().collectPairs(I.data() + sortedCount, J.data() + sortedCount, I.size() - sortedCount,
+                                   from, to, tail);
+        for (int k : tail) matches.push_back(sortedCount + k);
+        eraseEdges(matches);
+    }
+
+    // Удаление всех дуг, для которых remove(from, to) истинно, за один проход уплотнения
+    template<class Predicate>
+    void removeEdgesIf(Predicate remove) {
+        std::vector<int> matches;
+        GRAPH_COUNT(ScannedEdges, I.size());
+        for (size_t k = 0; k < I.size(); ++k) {
+            if (remove(I[k], J[k])) matches.push_back(k);
+        }
+        eraseEdges(matches);
+    }
+
+    // Поиск вершины
+    bool findVertex(int vertex) const {
+        GRAPH_COUNT(HashProbes, bucketLength(vertices, vertex));
+        return vertices.find(vertex) != vertices.end();
+    }
+
+    // Поиск дуги (возвращает индекс или -1)
+    int findEdge(int from, int to) const {
+        canonicalize(from, to);
+        if (edgeFilter && !edgeFilter->mayContain(from, to)) return -1;
+        // Двоичный поиск в упорядоченной части, затем просмотр буфера вставок
+        int first = lowerBound(edgeKey(from, to));
+        if (first < static_cast<int>(sortedCount) && I[first] == from && J[first] == to) return first;
+        GRAPH_COUNT(ScannedEdges, I.size() - sortedCount);
+        size_t k = sortedCount + scanKernels().findPair(I.data() + sortedCount, J.data() + sortedCount,
+                                                        I.size() - sortedCount, from, to);
+        return k < I.size() ? static_cast<int>(k) : -1;
+    }
+
+    // Число дуг, выходящих из вершины
+    int outDegree(int vertex) const {
+        return scanKernels().countEqual(I.data(), I.size(), vertex);
+    }
+
+    // Число дуг, входящих в вершину
+    int inDegree(int vertex) const {
+        return scanKernels().countEqual(J.data(), J.size(), vertex);
+    }
+
+    // Обход всех дуг: f(from, to, weight)
+    template<class F>
+    void forEachEdge(F f) const {
+        for (size_t k = 0; k < I.size(); ++k) {
+            f(I[k], J[k], weights[k]);
+        }
+    }
+
+    // Обход исходящих дуг вершины (для неориентированного графа — всех рёбер): f(to, weight)
+    template<class F>
+    void forEachNeighbor(int vertex, F f) const {
+        size_t start = 0;
+        if (sorted && !undirected) {
+            auto [first, last] = sourceRange(vertex);
+            for (int k = first; k < last; ++k) f(J[k], weights[k]);
+            start = sortedCount;
+        }
+        for (size_t k = start; k < I.size(); ++k) {
+            if (I[k] == vertex) {
+                f(J[k], weights[k]);
+            } else if (undirected && J[k] == vertex) {
+                f(I[k], weights[k]);
+            }
+        }
+    }
+
+    // Печать всех рёбер
+    void printEdges() {
+        for (size_t k = 0; k < I.size(); ++k) {
+            std::cout << "Edge " << k << ": " << I[k] << (undirected ? " -- " : " -> ") << J[k]
+                      << ", Weight: " << weights[k] << "\n";
+        }
+    }
+
+    // Печать всех вершин
+    void printVertices() {
+        std::cout << "Vertices: ";
+        for (const int &v : vertices) {
+            std::cout << v << " ";
+        }
+        std::cout << "\n";
+    }
+
+private:
+    bool sorted = false; // Режим упорядоченного списка
+    size_t sortedCount = 0; // Дуги [0, sortedCount) упорядочены по (I, J), остальные — буфер вставок
+
+    // Приведение ребра неориентированного графа к виду (min, max)
+    void canonicalize(int& from, int& to) const {
+        if (undirected && from > to) std::swap(from, to);
+    }
+
+    // Первый индекс упорядоченной части с ключом не меньше key
+    int lowerBound(uint64_t key) const {
+        size_t lo = 0, hi = sortedCount;
+        while (lo < hi) {
+            size_t mid = (lo + hi) / 2;
+            if (edgeKey(I[mid], J[mid]) < key) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        return lo;
+    }
+
+    // Размер буфера вставок, после которого он вливается в упорядоченную часть
+    size_t mergeThreshold() const {
+        return std::max<size_t>(256, 8 * static_cast<size_t>(std::sqrt(static_cast<double>(sortedCount))));
+    }
+
+    // Слияние буфера вставок с упорядоченной частью
+    void mergeTail() {
+        std::vector<int> tail = sortedEdgeOrder(I.data() + sortedCount, J.data() + sortedCount, I.size() - sortedCount);
+        std::vector<int> order;
+        order.reserve(I.size());
+        size_t a = 0, b = 0;
+        while (a < sortedCount || b < tail.size()) {
+            if (b == tail.size() ||
+                (a < sortedCount && edgeKey(I[a], J[a]) <= edgeKey(I[sortedCount + tail[b]], J[sortedCount + tail[b]]))) {
+                order.push_back(a++);
+            } else {
+                order.push_back(sortedCount + tail[b++]);
+            }
+        }
+        permuteEdges(order);
+        sortedCount = I.size();
+    }
+
+    // Перестановка дуг: новая дуга k — старая дуга order[k]
+    void permuteEdges(const std::vector<int>& order) {
+        Array<int> newI(order.size()), newJ(order.size());
+        Array<double> newWeights(order.size());
+        for (size_t k = 0; k < order.size(); ++k) {
+            newI[k] = I[order[k]];
+            newJ[k] = J[order[k]];
+            newWeights[k] = weights[order[k]];
+        }
+        I.swap(newI);
+        J.swap(newJ);
+        weights.swap(newWeights);
+        edgeProperties.select(order);
+    }
+
+    // Удаление дуг с данными индексами (по возрастанию) за один проход уплотнения
+    void eraseEdges(const std::vector<int>& indices) {
+        if (indices.empty()) return;
+        std::vector<int> kept;
+        kept.reserve(I.size() - indices.size());
+        size_t next = 0;
+        size_t removedSorted = 0;
+        for (size_t k = 0; k < I.size(); ++k) {
+            if (next < indices.size() && indices[next] == static_cast<int>(k)) {
+                ++next;
+                if (edgeFilter) edgeFilter->remove(I[k], J[k]);
+                if (k < sortedCount) ++removedSorted;
+                continue;
+            }
+            kept.push_back(k);
+        }
+        sortedCount -= removedSorted;
+        GRAPH_COUNT(ShiftedElements, 3 * (kept.size() - indices.front()));
+        for (size_t k = 0; k < kept.size(); ++k) {
+            I[k] = I[kept[k]];
+            J[k] = J[kept[k]];
+            weights[k] = weights[kept[k]];
+        }
+        I.resize(kept.size());
+        J.resize(kept.size());
+        weights.resize(kept.size());
+        edgeProperties.select(kept);
+    }
+};
+
+using EdgeListGraph = BasicEdgeListGraph<>;
+using HugePageEdgeListGraph = BasicEdgeListGraph<GraphAllocator>;
+
+// Список пучков дуг. Allocator — аллокатор массивов I, J, weights, H, L, как в BasicEdgeListGraph
+template<template<class> class Allocator = std::allocator>
+class BasicBundledEdgeListGraph {
+public:
+    template<class T>
+    using Array = std::vector<T, Allocator<T>>;
+
+    Array<int> I; // Начальные вершины дуг
+    Array<int> J; // Конечные вершины дуг
+    Array<double> weights; // Вес дуг
+    Array<int> H; // Массив голов списков пучков дуг
+    Array<int> L; // Массив ссылок на следующую дугу
+    std::unordered_set<int> vertices; // Уникальные вершины
+    PropertyColumns edgeProperties; // Свойства дуг, строка k — дуга k
+    PropertyColumns vertexProperties; // Свойства вершин, строка v — вершина v
+    std::optional<EdgeFilter> edgeFilter; // Фильтр отсутствующих дуг (необязательный)
+
+    // Конструктор для инициализации массивов
+    BasicBundledEdgeListGraph(int numVertices) {
+        H.resize(numVertices, -1);
+    }
+
+    // Включение фильтра отсутствующих дуг перед findEdge
+    void enableEdgeFilter(size_t expectedEdges = 0) {
+        edgeFilter.emplace(std::max(expectedEdges, I.size()));
+        forEachEdge([&](int from, int to, double) { edgeFilter->insert(from, to); });
+    }
+
+    // Вставка вершины
+    void insertVertex(int vertex) {
+        GRAPH_COUNT(HashProbes, bucketLength(vertices, vertex));
+        vertices.insert(vertex);
+        if (vertex >= H.size()) {
+            H.resize(vertex + 1, -1); // Расширение массива голов при необходимости
+        }
+        if (vertex >= static_cast<int>(vertexProperties.size())) {
+            vertexProperties.resize(vertex + 1);
+        }
+    }
+
+    // Вставка дуги
+    void insertEdge(int from, int to, double weight) {
+        resetDefragmentation();
+        int edgeIndex = I.size();
+        I.push_back(from);
+        J.push_back(to);
+        weights.push_back(weight);
+        edgeProperties.pushBack();
+
+        // Добавляем ссылку на предыдущую дугу
+        L.push_back(H[from]);
+        H[from] = edgeIndex;
+        if (edgeFilter && !edgeFilter->insert(from, to)) enableEdgeFilter(2 * edgeFilter->capacity());
+
+        // Добавляем вершины в набор, если их ещё нет
+        insertVertex(from);
+        insertVertex(to);
+    }
+
+    // Пакетная вставка дуг со слиянием кратных дуг всего графа по политике
+    void insertEdges(const std::vector<int>& from, const std::vector<int>& to, const std::vector<double>& weight,
+                     DuplicatePolicy policy = DuplicatePolicy::KeepAll) {
+        checkEdgeBatch(from, to, weight);
+        resetDefragmentation();
+        for (size_t k = 0; k < from.size(); ++k) {
+            insertVertex(from[k]);
+            insertVertex(to[k]);
+        }
+        I.insert(I.end(), from.begin(), from.end());
+        J.insert(J.end(), to.begin(), to.end());
+        weights.insert(weights.end(), weight.begin(), weight.end());
+        edgeProperties.resize(I.size());
+        coalesceEdges(I, J, weights, policy, &edgeProperties);
+
+        // Перестройка пучков: после слияния дуги вершины идут подряд; голова — дуга с наибольшим
+        // индексом, как после insertEdge
+        std::fill(H.begin(), H.end(), -1);
+        L.assign(I.size(), -1);
+        for (int k = 0; k < static_cast<int>(I.size()); ++k) {
+            L[k] = H[I[k]];
+            H[I[k]] = k;
+        }
+        if (edgeFilter) enableEdgeFilter(2 * I.size());
+    }
+
+    // Удаление дуги по индексу
+    void removeEdge(int index) {
+        if (index >= 0 && index < I.size()) {
+            resetDefragmentation();
+            int from = I[index];
+            if (edgeFilter) edgeFilter->remove(from, J[index]);
+
+            // Удаление дуги из списка пучков
+            if (H[from] == index) {
+                H[from] = L[index];
+            } else {
+                for (int i = H[from]; i != -1; i = L[i]) {
+                    GRAPH_COUNT(ChainSteps, 1);
+                    if (L[i] == index) {
+                        L[i] = L[index];
+                        break;
+                    }
+                }
+            }
+
+            // Удаление элементов из массивов
+            GRAPH_COUNT(ShiftedElements, 4 * (I.size() - index - 1));
+            I.erase(I.begin() + index);
+            J.erase(J.begin() + index);
+            weights.erase(weights.begin() + index);
+            L.erase(L.begin() + index);
+            edgeProperties.erase(index);
+
+            // Обновление ссылок после удаления элемента
+            GRAPH_COUNT(RenumberedLinks, L.size() + H.size());
+            for (int &link : L) {
+                if (link > index) {
+                    --link;
+                }
+            }
+            for (int &head : H) {
+                if (head > index) {
+                    --head;
+                }
+            }
+        }
+    }
+
+    // Удаление дуги по инцидентным вершинам
+    void removeEdge(int from, int to) {
+        if (edgeFilter && !edgeFilter->mayContain(from, to)) return;
+        for (int i = H[from]; i != -1;) {
+            GRAPH_COUNT(ChainSteps, 1);
+            if (J[i] == to) {
+                int next = L[i];
+                removeEdge(i);
+                // После дефрагментации цепочка идёт по возрастанию индексов: next сдвинулся
+                if (next > i) --next;
+                i = next;
+            } else {
+                i = L[i];
+            }
+        }
+    }
+
+    // Удаление вершины и всех её инцидентных рёбер
+    void removeVertex(int vertex) {
+        if (!findVertex(vertex)) return;
+
+        for (int i = H[vertex]; i != -1;) {
+            GRAPH_COUNT(ChainSteps, 1);
+            int next = L[i];
+            removeEdge(i);
+            if (next > i) --next;
+            i = next;
+        }
+
+        vertices.erase(vertex);
+        H[vertex] = -1; // Обнуление головы списка для удалённой вершины
+    }
+
+    // Дефрагментация пучков: дуги переставляются так, чтобы пучок каждой вершины занимал
+    // сплошной отрезок массивов в порядке цепочки, а вершины шли по возрастанию номера.
+    // Выполняется порциями: возвращает true, когда дефрагментация завершена; иначе продолжается
+    // следующим вызовом с места остановки. Любое изменение дуг начинает её заново
+    bool defragment(std::chrono::microseconds budget = std::chrono::microseconds::max()) {
+        auto deadline = budget == std::chrono::microseconds::max()
+                        ? std::chrono::steady_clock::time_point::max()
+                        : std::chrono::steady_clock::now() + budget;
+        if (defragVertex == 0 && defragPosition == 0) {
+            // Обратные ссылки P на время дефрагментации: предыдущая дуга цепочки или -1 для головы
+            P.assign(I.size(), -1);
+            for (int k = 0; k < static_cast<int>(L.size()); ++k) {
+                if (L[k] != -1) P[L[k]] = k;
+            }
+        }
+        size_t moved = 0;
+        for (; defragVertex < H.size(); ++defragVertex) {
+            for (int i = H[defragVertex]; i != -1; i = L[i]) {
+                swapEdgeSlots(i, defragPosition);
+                i = defragPosition++;
+                ++moved;
+            }
+            if (moved >= 256) {
+                moved = 0;
+                if (std::chrono::steady_clock::now() >= deadline) {
+                    ++defragVertex;
+                    return false;
+                }
+            }
+        }
+        resetDefragmentation();
+        return true;
+    }
+
+    // Поиск вершины
+    bool findVertex(int vertex) const {
+        GRAPH_COUNT(HashProbes, bucketLength(vertices, vertex));
+        return vertices.find(vertex) != vertices.end();
+    }
+
+    // Поиск дуги (возвращает индекс или -1)
+    int findEdge(int from, int to) const {
+        if (from < 0 || from >= static_cast<int>(H.size())) return -1;
+        if (edgeFilter && !edgeFilter->mayContain(from, to)) return -1;
+        for (int i = H[from]; i != -1; i = L[i]) {
+            GRAPH_COUNT(ChainSteps, 1);
+            if (J[i] == to) {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    // Обход всех дуг: f(from, to, weight)
+    template<class F>
+    void forEachEdge(F f) const {
+        for (size_t k = 0; k < I.size(); ++k) {
+            f(I[k], J[k], weights[k]);
+        }
+    }
+
+    // Обход пучка дуг вершины: f(to, weight)
+    template<class F>
+    void forEachNeighbor(int vertex, F f) const {
+        if (vertex < 0 || vertex >= static_cast<int>(H.size())) return;
+        for (int i = H[vertex]; i != -1; i = L[i]) {
+            GRAPH_COUNT(ChainSteps, 1);
+            f(J[i], weights[i]);
+        }
+    }
+
+    // Печать всех дуг
+    void printEdges() {
+        for (size_t k = 0; k < I.size(); ++k) {
+            std::cout << "Edge " << k << ": " << I[k] << " -> " << J[k]
+                      << ", Weight: " << weights[k] << "\n";
+        }
+    }
+
+    // Печать всех вершин
+    void printVertices() {
+        std::cout << "Vertices: ";
+        for (const int &v : vertices) {
+            std::cout << v << " ";
+        }
+        std::cout << "\n";
+    }
+
+private:
+    std::vector<int> P; // Обратные ссылки, существуют только во время дефрагментации
+    size_t defragVertex = 0; // Следующая вершина дефрагментации
+    int defragPosition = 0; // Дуги [0, defragPosition) уже на своих местах
+
+    void resetDefragmentation() {
+        defragVertex = 0;
+        defragPosition = 0;
+        P.clear();
+        P.shrink_to_fit();
+    }
+
+    // Обмен дуг в позициях a и b с исправлением ссылок H/L/P на них
+    void swapEdgeSlots(int a, int b) {
+        if (a == b) return;
+        auto moved = [&](int k) { return k == a ? b : k == b ? a : k; };
+        std::swap(I[a], I[b]);
+        std::swap(J[a], J[b]);
+        std::swap(weights[a], weights[b]);
+        std::swap(L[a], L[b]);
+        std::swap(P[a], P[b]);
+        edgeProperties.swapRows(a, b);
+        for (int k : {a, b}) {
+            if (L[k] != -1) L[k] = moved(L[k]);
+            if (P[k] != -1) P[k] = moved(P[k]);
+        }
+        for (int k : {a, b}) {
+            if (P[k] == -1) {
+                H[I[k]] = k;
+            } else {
+                L[P[k]] = k;
+            }
+            if (L[k] != -1) P[L[k]] = k;
+        }
+    }
+};
+
+using BundledEdgeListGraph = BasicBundledEdgeListGraph<>;
+using HugePageBundledEdgeListGraph = BasicBundledEdgeListGraph<GraphAllocator>;
+
+// Список смежности
+class AdjacencyListGraph {
+public:
+    // Дуга списка смежности: generation — поколение вершины to при вставке дуги (см. enableLazyDeletion).
+    // Поля упакованы в 16 байт, как std::pair<int, double>
+    struct Arc {
+        int to;
+        uint32_t generation;
+        double weight;
+    };
+
+    std::unordered_map<int, std::list<Arc>> adjList; // Словарь списков смежности
+    std::unordered_set<int> vertices; // Набор уникальных вершин
+    std::optional<EdgeFilter> edgeFilter; // Фильтр отсутствующих дуг (необязательный)
+
+    // Включение фильтра отсутствующих дуг перед findEdge
+    void enableEdgeFilter(size_t expectedEdges = 0) {
+        purgeDeleted();
+        edgeFilter.emplace(std::max(expectedEdges, edgeCount()));
+        forEachEdge([&](int from, int to, double) { edgeFilter->insert(from, to); });
+    }
+
+    // Число дуг
+    size_t edgeCount() const {
+        size_t count = 0;
+        for (const auto& [vertex, neighbors] : adjList) {
+            count += neighbors.size();
+            if (deletedCount > 0) {
+                for (const Arc& arc : neighbors) count -= isStale(arc);
+            }
+        }
+        return count;
+    }
+
+    // Ленивое удаление вершин: removeVertex удаляет только собственный список вершины и увеличивает
+    // её поколение; дуга, записанная с прежним поколением конца, висячая — читатели её пропускают.
+    // Повторно вставленная вершина получает новые дуги с новым поколением, старые остаются скрытыми
+    // без общей вычистки. Висячие дуги вычищаются одним проходом, когда удалений больше threshold
+    // от числа живых вершин. Вершины с отрицательными номерами удаляются сразу
+    void enableLazyDeletion(double threshold = 0.25) {
+        lazyThreshold = threshold;
+    }
+
+    void disableLazyDeletion() {
+        purgeDeleted();
+        lazyThreshold = 0;
+    }
+
+    // Число ленивых удалений вершин, висячие дуги которых ещё не вычищены
+    size_t pendingDeletions() const {
+        return deletedCount;
+    }
+
+    // Вычистка висячих дуг за один проход O(V + E)
+    void purgeDeleted() {
+        if (deletedCount == 0) return;
+        for (auto& [key, neighbors] : adjList) {
+            GRAPH_COUNT(ListNodes, neighbors.size());
+            int from = key;
+            neighbors.remove_if([&](const Arc& arc) {
+                if (!isStale(arc)) return false;
+                if (edgeFilter) edgeFilter->remove(from, arc.to);
+                return true;
+            });
+        }
+        deletedCount = 0;
+    }
+
+    // Вставка вершины
+    void insertVertex(int vertex) {
+        GRAPH_COUNT(HashProbes, bucketLength(vertices, vertex) + bucketLength(adjList, vertex));
+        vertices.insert(vertex);
+        if (adjList.find(vertex) == adjList.end()) {
+            adjList[vertex] = std::list<Arc>(); // Инициализация списка для вершины
+        }
+    }
+
+    // Вставка дуги
+    void insertEdge(int from, int to, double weight) {
+        GRAPH_COUNT(HashProbes, bucketLength(adjList, from));
+        adjList[from].push_back(Arc{to, generationOf(to), weight});
+        if (edgeFilter && !edgeFilter->insert(from, to)) enableEdgeFilter(2 * edgeFilter->capacity());
+        insertVertex(from);
+        insertVertex(to);
+    }
+
+    // Пакетная вставка дуг со слиянием кратных дуг всего графа по политике
+    void insertEdges(const std::vector<int>& from, const std::vector<int>& to, const std::vector<double>& weight,
+                     DuplicatePolicy policy = DuplicatePolicy::KeepAll) {
+        checkEdgeBatch(from, to, weight);
+        if (policy == DuplicatePolicy::KeepAll) {
+            for (size_t k = 0; k < from.size(); ++k) insertEdge(from[k], to[k], weight[k]);
+            return;
+        }
+        purgeDeleted();
+        std::vector<int> I, J;
+        std::vector<double> weights;
+        forEachEdge([&](int u, int v, double w) {
+            I.push_back(u);
+            J.push_back(v);
+            weights.push_back(w);
+        });
+        I.insert(I.end(), from.begin(), from.end());
+        J.insert(J.end(), to.begin(), to.end());
+        weights.insert(weights.end(), weight.begin(), weight.end());
+        coalesceEdges(I, J, weights, policy);
+
+        bool filtered = edgeFilter.has_value();
+        edgeFilter.reset();
+        for (auto& [vertex, neighbors] : adjList) neighbors.clear();
+        for (size_t k = 0; k < I.size(); ++k) insertEdge(I[k], J[k], weights[k]);
+        if (filtered) enableEdgeFilter(2 * I.size());
+    }
+
+    // Удаление дуги
+    void removeEdge(int from, int to) {
+        if (edgeFilter && !edgeFilter->mayContain(from, to)) return;
+        GRAPH_COUNT(HashProbes, bucketLength(adjList, from));
+        if (adjList.find(from) != adjList.end()) {
+            size_t before = adjList[from].size();
+            GRAPH_COUNT(ListNodes, before);
+            adjList[from].remove_if([to](const Arc& arc) {
+                return arc.to == to;
+            });
+            for (size_t k = adjList[from].size(); edgeFilter && k < before; ++k) edgeFilter->remove(from, to);
+        }
+    }
+
+    // Удаление всех дуг, для которых remove(from, to) истинно, за один проход O(V + E)
+    template<class Predicate>
+    void removeEdgesIf(Predicate remove) {
+        for (auto& [key, neighbors] : adjList) {
+            GRAPH_COUNT(ListNodes, neighbors.size());
+            int from = key;
+            neighbors.remove_if([&](const Arc& arc) {
+                if (!remove(from, arc.to)) return false;
+                if (edgeFilter) edgeFilter->remove(from, arc.to);
+                return true;
+            });
+        }
+    }
+
+    // Удаление вершины
+    void removeVertex(int vertex) {
+        bool lazy = lazyThreshold > 0 && vertex >= 0;
+        if (lazy && !findVertex(vertex)) return;
+        GRAPH_COUNT(HashProbes, bucketLength(adjList, vertex));
+        auto own = adjList.find(vertex);
+        if (edgeFilter && own != adjList.end()) {
+            for (const Arc& arc : own->second) edgeFilter->remove(vertex, arc.to);
+        }
+        adjList.erase(vertex);
+        if (lazy) {
+            if (static_cast<size_t>(vertex) >= generations.size()) generations.resize(vertex + 1, 0);
+            ++generations[vertex];
+            ++deletedCount;
+            vertices.erase(vertex);
+            if (deletedCount > lazyThreshold * std::max<size_t>(vertices.size(), 1)) purgeDeleted();
+            return;
+        }
+        for (auto& [key, neighbors] : adjList) {
+            size_t before = neighbors.size();
+            GRAPH_COUNT(ListNodes, before);
+            neighbors.remove_if([vertex](const Arc& arc) {
+                return arc.to == vertex;
+            });
+            for (size_t k = neighbors.size(); edgeFilter && k < before; ++k) edgeFilter->remove(key, vertex);
+        }
+        vertices.erase(vertex);
+    }
+
+    // Поиск вершины
+    bool findVertex(int vertex) const {
+        GRAPH_COUNT(HashProbes, bucketLength(vertices, vertex));
+        return vertices.find(vertex) != vertices.end();
+    }
+
+    // Поиск дуги
+    bool findEdge(int from, int to) const {
+        if (edgeFilter && !edgeFilter->mayContain(from, to)) return false;
+        GRAPH_COUNT(HashProbes, bucketLength(adjList, from));
+        auto it = adjList.find(from);
+        if (it != adjList.end()) {
+            for (const Arc& arc : it->second) {
+                GRAPH_COUNT(ListNodes, 1);
+                if (arc.to == to && !isStale(arc)) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    // Обход всех дуг: f(from, to, weight)
+    template<class F>
+    void forEachEdge(F f) const {
+        for (const auto& [vertex, neighbors] : adjList) {
+            for (const Arc& arc : neighbors) {
+                if (!isStale(arc)) f(vertex, arc.to, arc.weight);
+            }
+        }
+    }
+
+    // Обход списка смежности вершины: f(to, weight)
+    template<class F>
+    void forEachNeighbor(int vertex, F f) const {
+        GRAPH_COUNT(HashProbes, bucketLength(adjList, vertex));
+        auto it = adjList.find(vertex);
+        if (it == adjList.end()) return;
+        for (const Arc& arc : it->second) {
+            GRAPH_COUNT(ListNodes, 1);
+            if (!isStale(arc)) f(arc.to, arc.weight);
+        }
+    }
+
+    // Печать всех дуг
+    void printEdges() {
+        forEachEdge([](int vertex, int to, double weight) {
+            std::cout << "Edge: " << vertex << " -> " << to
+                      << ", Weight: " << weight << "\n";
+        });
+    }
+
+private:
+    double lazyThreshold = 0; // Порог вычистки ленивого удаления; 0 — удаление сразу
+    std::vector<uint32_t> generations; // Поколение вершины: число её ленивых удалений
+    size_t deletedCount = 0; // Ленивые удаления с момента последней вычистки
+
+    uint32_t generationOf(int vertex) const {
+        return vertex >= 0 && static_cast<size_t>(vertex) < generations.size() ? generations[vertex] : 0;
+    }
+
+    // Дуга записана до ленивого удаления своего конца. Без невычищенных удалений висячих дуг нет
+    bool isStale(const Arc& arc) const {
+        return deletedCount > 0 && arc.generation != generationOf(arc.to);
+    }
+};
+
+// Формат хранения весов дуг
+enum class WeightFormat {
+    Float64, // double без сжатия, 8 байт
+    Half, // IEEE 754 половинной точности, 2 байта: ~3 значащих цифры, диапазон до 65504
+    BFloat16, // Старшие 16 бит float, 2 байта: ~2-3 значащих цифры, диапазон float
+    Codebook // Словарь из 256 значений на граф и 1-байтные коды
+};
+
+// Сжатый массив весов. Чтение по одному — operator[], обход — forEach, пакетное — decode и sumSegments
+class QuantizedWeights {
+public:
+    QuantizedWeights() = default;
+
+    QuantizedWeights(const std::vector<double>& weights, WeightFormat format) : storage(format), count(weights.size()) {
+        switch (format) {
+            case WeightFormat::Float64:
+                wide = weights;
+                break;
+            case WeightFormat::Half:
+                narrow.resize(count);
+                for (size_t k = 0; k < count; ++k) narrow[k] = floatToHalf(static_cast<float>(weights[k]));
+                break;
+            case WeightFormat::BFloat16:
+                narrow.resize(count);
+                for (size_t k = 0; k < count; ++k) narrow[k] = floatToBFloat16(static_cast<float>(weights[k]));
+                break;
+            case WeightFormat::Codebook:
+                buildCodebook(weights);
+                break;
+        }
+    }
+
+    WeightFormat format() const {
+        return storage;
+    }
+
+    size_t size() const {
+        return count;
+    }
+
+    // Объём хранимых весов в байтах
+    size_t bytes() const {
+        return wide.size() * 8 + narrow.size() * 2 + codes.size() + (storage == WeightFormat::Codebook ? 256 * 4 : 0);
+    }
+
+    double operator[](size_t k) const {
+        switch (storage) {
+            case WeightFormat::Float64: return wide[k];
+            case WeightFormat::Half: return halfToFloat(narrow[k]);
+            case WeightFormat::BFloat16: return bfloat16ToFloat(narrow[k]);
+            default: return codebook[codes[k]];
+        }
+    }
+
+    // Обход весов [begin, end): f(индекс, вес). Декодирование встроено в цикл обхода,
+    // формат и набор команд выбираются один раз на вызов
+    template<class F>
+    void forEach(size_t begin, size_t end, F f) const {
+        switch (storage) {
+            case WeightFormat::Float64:
+                for (size_t k = begin; k < end; ++k) f(k, wide[k]);
+                break;
+            case WeightFormat::Half:
+#ifdef GRAPH_X86_KERNELS
+                if (weightKernels().f16c) {
+                    sweepHalfAvx2(narrow.data(), begin, end, f);
+                    break;
+                }
+#endif
+                sweepHalfScalar(narrow.data(), begin, end, f);
+                break;
+            case WeightFormat::BFloat16:
+                for (size_t k = begin; k < end; ++k) f(k, bfloat16ToFloat(narrow[k]));
+                break;
+            case WeightFormat::Codebook:
+                for (size_t k = begin; k < end; ++k) f(k, codebook[codes[k]]);
+                break;
+        }
+    }
+
+    // Суммы весов отрезков [offsets[v], offsets[v + 1]) всех v < segments одним вызовом ядра
+    void sumSegments(const int* offsets, size_t segments, double* out) const {
+        const WeightKernels& kernels = weightKernels();
+        switch (storage) {
+            case WeightFormat::Float64:
+                sumSegmentsScalar(wide.data(), offsets, segments, out, [](double w) { return w; });
+                break;
+            case WeightFormat::Half: kernels.sumSegmentsHalf(narrow.data(), offsets, segments, out); break;
+            case WeightFormat::BFloat16: kernels.sumSegmentsBFloat16(narrow.data(), offsets, segments, out); break;
+            case WeightFormat::Codebook:
+                sumSegmentsScalar(codes.data(), offsets, segments, out, [&](uint8_t c) { return codebook[c]; });
+                break;
+        }
+    }
+
+    // Пакетное декодирование весов [first, first + n) в out
+    void decode(size_t first, size_t n, float* out) const {
+        const WeightKernels& kernels = weightKernels();
+        switch (storage) {
+            case WeightFormat::Float64:
+                for (size_t k = 0; k < n; ++k) out[k] = static_cast<float>(wide[first + k]);
+                break;
+            case WeightFormat::Half: kernels.decodeHalf(narrow.data() + first, n, out); break;
+            case WeightFormat::BFloat16: kernels.decodeBFloat16(narrow.data() + first, n, out); break;
+            case WeightFormat::Codebook: kernels.decodeCodebook(codes.data() + first, n, codebook.data(), out); break;
+        }
+    }
+
+private:
+    WeightFormat storage = WeightFormat::Float64;
+    size_t count = 0;
+    std::vector<double> wide;
+    std::vector<uint16_t> narrow;
+    std::vector<uint8_t> codes;
+    std::array<float, 256> codebook{};
+
+    // Словарь одномерным k-средних: начальные центры — квантили, затем уточнение Ллойдом
+    // по упорядоченным весам; при не более чем 256 различных весах словарь точный
+    void buildCodebook(const std::vector<double>& weights) {
+        std::vector<double> sorted(weights);
+        std::sort(sorted.begin(), sorted.end());
+        sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+        std::vector<double> centers;
+        if (sorted.size() <= codebook.size()) {
+            centers = sorted;
+        } else {
+            std::vector<double> all(weights);
+            std::sort(all.begin(), all.end());
+            for (size_t c = 0; c < codebook.size(); ++c) centers.push_back(all[(2 * c + 1) * all.size() / 512]);
+            for (int iteration = 0; iteration < 8; ++iteration) {
+                centers.erase(std::unique(centers.begin(), centers.end()), centers.end());
+                std::vector<double> sum(centers.size(), 0.0);
+                std::vector<size_t> members(centers.size(), 0);
+                size_t c = 0;
+                for (double w : all) {
+                    while (c + 1 < centers.size() && w > (centers[c] + centers[c + 1]) / 2) ++c;
+                    sum[c] += w;
+                    ++members[c];
+                }
+                for (size_t k = 0; k < centers.size(); ++k) {
+                    if (members[k] > 0) centers[k] = sum[k] / members[k];
+                }
+            }
+        }
+        for (size_t c = 0; c < codebook.size(); ++c) {
+            codebook[c] = centers.empty() ? 0.0f : static_cast<float>(centers[std::min(c, centers.size() - 1)]);
+        }
+        codes.resize(count);
+        for (size_t k = 0; k < count; ++k) {
+            // Ближайший центр: первый центр не меньше веса или предыдущий
+            size_t c = std::lower_bound(centers.begin(), centers.end(), weights[k]) - centers.begin();
+            if (c == centers.size() || (c > 0 && weights[k] - centers[c - 1] < centers[c] - weights[k])) --c;
+            codes[k] = static_cast<uint8_t>(c);
+        }
+    }
+};
+
+// Сжатое хранение строк (CSR): статическое представление для чтения
+// Номера вершин неотрицательны, как и в BundledEdgeListGraph.
+// WeightStorage — хранилище весов: std::vector<double> или QuantizedWeights (QuantizedCsrGraph)
+template<class WeightStorage = std::vector<double>>
+class BasicCsrGraph {
+public:
+    std::vector<int> offsets; // Начало пучка дуг вершины v: offsets[v], конец: offsets[v + 1]
+    std::vector<int> targets; // Конечные вершины дуг, упорядоченные внутри пучка
+    WeightStorage weights; // Вес дуг
+    std::unordered_set<int> vertices; // Уникальные вершины
+    bool symmetric = false; // Симметричное представление неориентированного графа: ребро в обоих пучках
+
+    BasicCsrGraph() : offsets(1, 0) {}
+
+    // Построение по массивам дуг подсчётом (O(V + E))
+    template<class IntArray, class WeightArray>
+    BasicCsrGraph(const IntArray& I, const IntArray& J, const WeightArray& w,
+             const std::unordered_set<int>& vertexSet, bool symmetric = false)
+            : vertices(vertexSet), symmetric(symmetric) {
+        int minVertex = 0, maxVertex = -1;
+        for (int v : vertexSet) {
+            minVertex = std::min(minVertex, v);
+            maxVertex = std::max(maxVertex, v);
+        }
+        for (size_t k = 0; k < I.size(); ++k) {
+            minVertex = std::min(minVertex, std::min(I[k], J[k]));
+            maxVertex = std::max(maxVertex, std::max(I[k], J[k]));
+        }
+        if (minVertex < 0) throw std::invalid_argument("CsrGraph requires non-negative vertex ids");
+
+        offsets.assign(maxVertex + 2, 0);
+        for (size_t k = 0; k < I.size(); ++k) {
+            ++offsets[I[k] + 1];
+            if (symmetric && I[k] != J[k]) ++offsets[J[k] + 1];
+        }
+        for (size_t v = 1; v < offsets.size(); ++v) offsets[v] += offsets[v - 1];
+
+        targets.resize(offsets.back());
+        weights.resize(offsets.back());
+        std::vector<int> pos(offsets.begin(), offsets.end() - 1);
+        for (size_t k = 0; k < I.size(); ++k) {
+            int p = pos[I[k]]++;
+            targets[p] = J[k];
+            weights[p] = w[k];
+            if (symmetric && I[k] != J[k]) {
+                p = pos[J[k]]++;
+                targets[p] = I[k];
+                weights[p] = w[k];
+            }
+        }
+
+        // Сортировка пучков по конечной вершине для двоичного поиска
+        std::vector<std::pair<int, double>> bundle;
+        for (size_t v = 0; v + 1 < offsets.size(); ++v) {
+            int begin = offsets[v], end = offsets[v + 1];
+            if (end - begin < 2) continue;
+            bundle.clear();
+            for (int p = begin; p < end; ++p) bundle.emplace_back(targets[p], weights[p]);
+            std::stable_sort(bundle.begin(), bundle.end(),
+                             [](const auto& a, const auto& b) { return a.first < b.first; });
+            for (int p = begin; p < end; ++p) {
+                targets[p] = bundle[p - begin].first;
+                weights[p] = bundle[p - begin].second;
+            }
+        }
+    }
+
+    // Для неориентированного списка дуг строится симметричное представление
+    explicit BasicCsrGraph(const EdgeListGraph& g) : BasicCsrGraph(g.I, g.J, g.weights, g.vertices, g.undirected) {}
+
+    // Копия CSR с весами, сжатыми в формат format (для WeightStorage = QuantizedWeights)
+    BasicCsrGraph(const BasicCsrGraph<>& g, WeightFormat format)
+            : offsets(g.offsets), targets(g.targets), weights(g.weights, format), vertices(g.vertices),
+              symmetric(g.symmetric) {}
+
+    // Число вершин в массиве смещений
+    int vertexSlots() const {
+        return offsets.size() - 1;
+    }
+
+    // Поиск вершины
+    bool findVertex(int vertex) const {
+        return vertices.find(vertex) != vertices.end();
+    }
+
+    // Поиск дуги двоичным поиском в пучке (возвращает индекс или -1)
+    int findEdge(int from, int to) const {
+        if (from < 0 || from >= vertexSlots()) return -1;
+        auto begin = targets.begin() + offsets[from];
+        auto end = targets.begin() + offsets[from + 1];
+        auto it = std::lower_bound(begin, end, to);
+        return it != end && *it == to ? it - targets.begin() : -1;
+    }
+
+    // Вес дуги по индексу
+    double weight(int index) const {
+        return weights[index];
+    }
+
+    // Обход всех дуг (рёбра симметричного представления — один раз): f(from, to, weight).
+    // Сжатые веса декодируются одним проходом по всему массиву, а не по пучку за вызов
+    template<class F>
+    void forEachEdge(F f) const {
+        if constexpr (std::is_same_v<WeightStorage, std::vector<double>>) {
+            for (int v = 0; v < vertexSlots(); ++v) {
+                for (int p = offsets[v]; p < offsets[v + 1]; ++p) {
+                    if (!symmetric || v <= targets[p]) f(v, targets[p], weights[p]);
+                }
+            }
+        } else {
+            // Веса декодируются большими непрерывными отрезками через пучки, пучки идут подряд
+            constexpr int chunk = 4096;
+            float decoded[chunk];
+            int v = 0, edges = static_cast<int>(targets.size());
+            for (int begin = 0; begin < edges; begin += chunk) {
+                int end = std::min(edges, begin + chunk);
+                weights.decode(begin, end - begin, decoded);
+                for (int p = begin; p < end;) {
+                    while (offsets[v + 1] <= p) ++v;
+                    // Проверка symmetric вынесена из цикла: безусловный вызов f позволяет держать
+                    // накопители f в регистрах, а не в памяти
+                    int stop = std::min(end, offsets[v + 1]);
+                    if (symmetric) {
+                        for (; p < stop; ++p) {
+                            if (v <= targets[p]) f(v, targets[p], decoded[p - begin]);
+                        }
+                    } else {
+                        for (; p < stop; ++p) f(v, targets[p], decoded[p - begin]);
+                    }
+                }
+            }
+        }
+    }
+
+    // Обход пучка дуг вершины: f(to, weight)
+    template<class F>
+    void forEachNeighbor(int vertex, F f) const {
+        if (vertex < 0 || vertex >= vertexSlots()) return;
+        if constexpr (std::is_same_v<WeightStorage, std::vector<double>>) {
+            for (int p = offsets[vertex]; p < offsets[vertex + 1]; ++p) {
+                f(targets[p], weights[p]);
+            }
+        } else {
+            weights.forEach(offsets[vertex], offsets[vertex + 1], [&](size_t p, double weight) { f(targets[p], weight); });
+        }
+    }
+
+    // Сумма весов пучка каждой вершины (взвешенная исходящая степень) одним проходом по весам
+    std::vector<double> weightedDegrees() const {
+        std::vector<double> degrees(vertexSlots());
+        if constexpr (std::is_same_v<WeightStorage, std::vector<double>>) {
+            sumSegmentsScalar(weights.data(), offsets.data(), degrees.size(), degrees.data(), [](double w) { return w; });
+        } else {
+            weights.sumSegments(offsets.data(), degrees.size(), degrees.data());
+        }
+        return degrees;
+    }
+
+    // Печать всех дуг
+    void printEdges() const {
+        forEachEdge([](int from, int to, double weight) {
+            std::cout << "Edge: " << from << " -> " << to << ", Weight: " << weight << "\n";
+        });
+    }
+};
+
+using CsrGraph = BasicCsrGraph<>;
+
+// CSR со сжатыми весами: меньше байт на дугу при обходе
+using QuantizedCsrGraph = BasicCsrGraph<QuantizedWeights>;
+
+// Адаптивный граф: следит за смесью операций и плотностью графа
+// и в фоне переходит к подходящему представлению:
+// список дуг при загрузке, список смежности при смешанной нагрузке, CSR при чтении
+class AdaptiveGraph {
+public:
+    enum class Layout { EdgeList, Adjacency, Csr };
+
+    int window = 4096; // Число операций между пересмотрами представления
+    size_t minEdges = 1024; // Меньшие графы не переносятся
+    double readMostlyShare = 0.9; // Доля чтений, после которой выбирается CSR
+    double ingestShare = 0.9; // Доля вставок, после которой выбирается список дуг
+
+    AdaptiveGraph() : current(std::make_shared<Snapshot>()) {}
+
+    ~AdaptiveGraph() {
+        if (next.valid()) next.wait();
+        if (retired.valid()) retired.wait();
+    }
+
+    // Текущее представление
+    Layout layout() const {
+        return layoutOf(current->base);
+    }
+
+    // Идёт ли перенос в фоне
+    bool migrating() const {
+        return next.valid();
+    }
+
+    // Дождаться окончания переноса
+    void waitMigration() {
+        while (next.valid()) {
+            next.wait();
+            install();
+        }
+    }
+
+    // Вставка вершины
+    void insertVertex(int vertex) {
+        countOperation(inserts);
+        negativeVertices = negativeVertices || vertex < 0;
+        if (Overlay* o = writableOverlay()) {
+            o->added.insertVertex(vertex);
+            return;
+        }
+        mutateBase(current->base, [&](auto& g) { g.insertVertex(vertex); });
+    }
+
+    // Вставка дуги
+    void insertEdge(int from, int to, double weight) {
+        countOperation(inserts);
+        ++edgeCount;
+        negativeVertices = negativeVertices || from < 0 || to < 0;
+        if (Overlay* o = writableOverlay()) {
+            o->added.insertEdge(from, to, weight);
+            return;
+        }
+        mutateBase(current->base, [&](auto& g) { g.insertEdge(from, to, weight); });
+    }
+
+    // Удаление дуги (всех дуг с данными вершинами)
+    void removeEdge(int from, int to) {
+        countOperation(removes);
+        if (Overlay* o = writableOverlay()) {
+            edgeCount -= std::min(edgeCount, overlaidOutEdges(from, &to));
+            o->added.removeEdge(from, to);
+            o->removedEdges.insert(pairKey(from, to));
+            return;
+        }
+        size_t before = knownEdges(current->base, from);
+        mutateBase(current->base, [&](auto& g) { g.removeEdge(from, to); });
+        edgeCount -= std::min(edgeCount, before - knownEdges(current->base, from));
+    }
+
+    // Удаление вершины и всех её инцидентных дуг
+    void removeVertex(int vertex) {
+        countOperation(removes);
+        if (Overlay* o = writableOverlay()) {
+            edgeCount -= std::min(edgeCount, overlaidOutEdges(vertex));
+            o->added.removeVertex(vertex);
+            o->removedVertices.insert(vertex);
+            return;
+        }
+        size_t before = knownEdges(current->base, vertex);
+        mutateBase(current->base, [&](auto& g) { g.removeVertex(vertex); });
+        edgeCount -= std::min(edgeCount, before - knownEdges(current->base, vertex));
+    }
+
+    // Поиск вершины
+    bool findVertex(int vertex) {
+        countOperation(finds);
+        auto inSnapshot = [&] { return snapshotHasVertex(*current, vertex); };
+        return next.valid() ? overlayHasVertex(pending, vertex, inSnapshot) : inSnapshot();
+    }
+
+    // Поиск дуги
+    bool findEdge(int from, int to) {
+        countOperation(finds);
+        auto inSnapshot = [&] { return snapshotHasEdge(*current, from, to); };
+        return next.valid() ? overlayHasEdge(pending, from, to, inSnapshot) : inSnapshot();
+    }
+
+    // Обход исходящих дуг вершины: f(to, weight)
+    template<class F>
+    void forEachNeighbor(int vertex, F f) {
+        countOperation(iterations);
+        if (next.valid()) {
+            overlayNeighbors(pending, vertex, f, [&](auto g) { snapshotNeighbors(*current, vertex, g); });
+        } else {
+            snapshotNeighbors(*current, vertex, f);
+        }
+    }
+
+private:
+    using Base = std::variant<EdgeListGraph, AdjacencyListGraph, CsrGraph>;
+
+    // Изменения поверх неизменяемого представления
+    struct Overlay {
+        EdgeListGraph added; // Добавленные дуги и вершины
+        std::unordered_set<long long> removedEdges; // Удалённые пары (from, to)
+        std::unordered_set<int> removedVertices; // Удалённые вершины
+
+        bool empty() const {
+            return added.I.empty() && added.vertices.empty() && removedEdges.empty() && removedVertices.empty();
+        }
+    };
+
+    struct Snapshot {
+        Base base;
+        Overlay overlay; // Изменения поверх CSR или удаления, не вошедшие в основу при установке
+    };
+
+    // Представление, построенное в фоне, и точное число его дуг
+    struct Built {
+        Base base;
+        size_t edges = 0;
+    };
+
+    std::shared_ptr<Snapshot> current; // Во время переноса доступен фоновому потоку только для чтения
+    Overlay pending; // Изменения, сделанные во время переноса
+    std::future<Built> next; // Строящееся представление
+    std::future<void> retired; // Разрушение прежнего снимка в фоне
+    std::unordered_set<int> replayedVertices; // Удаления pending, уже применённые к строящейся основе
+    std::unordered_set<long long> replayedEdges;
+    bool replaying = false; // next — проход удалений по готовой основе
+    size_t edgeCount = 0; // Оценка числа дуг; точное значение восстанавливается при установке
+    bool negativeVertices = false; // Были вершины с отрицательными номерами: CSR недоступен
+    int inserts = 0, removes = 0, finds = 0, iterations = 0, operations = 0;
+
+    static long long pairKey(int from, int to) {
+        return static_cast<long long>(static_cast<uint64_t>(static_cast<unsigned int>(from)) << 32 |
+                                      static_cast<unsigned int>(to));
+    }
+
+    static Layout layoutOf(const Base& base) {
+        return static_cast<Layout>(base.index());
+    }
+
+    // Число видимых дуг из from (только в *to, если задано) при записи в Overlay; не учитывается
+    // в смеси операций. Под списком дуг пучок — полный просмотр дуг, поэтому там 0: оценка
+    // всё равно уточняется при установке следующего представления
+    size_t overlaidOutEdges(int from, const int* to = nullptr) const {
+        if (layout() == Layout::EdgeList) return 0;
+        size_t count = 0;
+        auto f = [&](int v, double) { count += !to || v == *to; };
+        if (next.valid()) {
+            overlayNeighbors(pending, from, f, [&](auto g) { snapshotNeighbors(*current, from, g); });
+        } else {
+            snapshotNeighbors(*current, from, f);
+        }
+        return count;
+    }
+
+    // Число дуг изменяемой основы, известное за O(1): все дуги списка дуг или пучок vertex
+    // списка смежности. Его убыль при удалении — убыль edgeCount
+    static size_t knownEdges(const Base& base, int vertex) {
+        if (const EdgeListGraph* g = std::get_if<EdgeListGraph>(&base)) return g->I.size();
+        if (const AdjacencyListGraph* g = std::get_if<AdjacencyListGraph>(&base)) {
+            auto it = g->adjList.find(vertex);
+            return it == g->adjList.end() ? 0 : it->second.size();
+        }
+        return 0;
+    }
+
+    // Изменение основы; CSR не изменяется на месте, его изменения идут через Overlay
+    template<class F>
+    static void mutateBase(Base& base, F f) {
+        std::visit([&](auto& g) {
+            if constexpr (!std::is_same_v<std::decay_t<decltype(g)>, CsrGraph>) f(g);
+        }, base);
+    }
+
+    // Куда писать изменение: в Overlay при переносе, поверх CSR или поверх непустого Overlay снимка,
+    // иначе nullptr
+    Overlay* writableOverlay() {
+        if (next.valid()) return &pending;
+        if (layout() == Layout::Csr || !current->overlay.empty()) return &current->overlay;
+        return nullptr;
+    }
+
+    template<class Fallback>
+    static bool overlayHasVertex(const Overlay& o, int vertex, Fallback below) {
+        if (o.added.findVertex(vertex)) return true;
+        return o.removedVertices.count(vertex) == 0 && below();
+    }
+
+    template<class Fallback>
+    static bool overlayHasEdge(const Overlay& o, int from, int to, Fallback below) {
+        if (o.added.findEdge(from, to) != -1) return true;
+        if (o.removedVertices.count(from) || o.removedVertices.count(to)) return false;
+        return o.removedEdges.count(pairKey(from, to)) == 0 && below();
+    }
+
+    template<class F, class Below>
+    static void overlayNeighbors(const Overlay& o, int vertex, F& f, Below below) {
+        if (o.removedVertices.count(vertex) == 0) {
+            below([&](int to, double weight) {
+                if (o.removedVertices.count(to) == 0 && o.removedEdges.count(pairKey(vertex, to)) == 0) {
+                    f(to, weight);
+                }
+            });
+        }
+        o.added.forEachNeighbor(vertex, f);
+    }
+
+    static bool snapshotHasVertex(const Snapshot& s, int vertex) {
+        return overlayHasVertex(s.overlay, vertex, [&] {
+            return std::visit([&](const auto& g) { return g.findVertex(vertex); }, s.base);
+        });
+    }
+
+    static bool snapshotHasEdge(const Snapshot& s, int from, int to) {
+        return overlayHasEdge(s.overlay, from, to, [&] {
+            return std::visit([&](const auto& g) -> bool {
+                if constexpr (std::is_same_v<std::decay_t<decltype(g)>, AdjacencyListGraph>) {
+                    return g.findEdge(from, to);
+                } else {
+                    return g.findEdge(from, to) != -1;
+                }
+            }, s.base);
+        });
+    }
+
+    template<class F>
+    static void snapshotNeighbors(const Snapshot& s, int vertex, F& f) {
+        overlayNeighbors(s.overlay, vertex, f, [&](auto g) {
+            std::visit([&](const auto& base) { base.forEachNeighbor(vertex, g); }, s.base);
+        });
+    }
+
+    // Материализация снимка (основа + Overlay) в представление layout; выполняется в фоне
+    static Built materialize(const Snapshot& s, Layout layout) {
+        EdgeListGraph edges;
+        std::visit([&](const auto& g) {
+            for (int v : g.vertices) {
+                if (s.overlay.removedVertices.count(v) == 0) edges.insertVertex(v);
+            }
+            g.forEachEdge([&](int from, int to, double weight) {
+                if (s.overlay.removedVertices.count(from) == 0 && s.overlay.removedVertices.count(to) == 0 &&
+                    s.overlay.removedEdges.count(pairKey(from, to)) == 0) {
+                    edges.insertEdge(from, to, weight);
+                }
+            });
+        }, s.base);
+        s.overlay.added.forEachEdge([&](int from, int to, double weight) { edges.insertEdge(from, to, weight); });
+        for (int v : s.overlay.added.vertices) edges.insertVertex(v);
+
+        size_t count = edges.I.size();
+        if (layout == Layout::Csr) return {CsrGraph(edges), count};
+        if (layout == Layout::EdgeList) return {std::move(edges), count};
+        AdjacencyListGraph adjacency;
+        for (int v : edges.vertices) adjacency.insertVertex(v);
+        edges.forEachEdge([&](int from, int to, double weight) { adjacency.insertEdge(from, to, weight); });
+        return {std::move(adjacency), count};
+    }
+
+    // Уплотнение изменяемой основы по удалениям одним проходом O(V + E); выполняется в фоне
+    static void replayRemovals(Built& built, const std::unordered_set<int>& removedVertices,
+                               const std::unordered_set<long long>& removedEdges) {
+        mutateBase(built.base, [&](auto& base) {
+            base.removeEdgesIf([&](int from, int to) {
+                return removedVertices.count(from) || removedVertices.count(to) ||
+                       removedEdges.count(pairKey(from, to));
+            });
+            for (int v : removedVertices) {
+                if constexpr (std::is_same_v<std::decay_t<decltype(base)>, AdjacencyListGraph>) base.adjList.erase(v);
+                base.vertices.erase(v);
+            }
+            if constexpr (std::is_same_v<std::decay_t<decltype(base)>, AdjacencyListGraph>) {
+                built.edges = base.edgeCount();
+            } else {
+                built.edges = base.I.size();
+            }
+        });
+    }
+
+    // Установка готового представления. Удаления, сделанные за время переноса, один раз применяются
+    // к новой основе в фоне до замены; удаления, пришедшие во время этого прохода, остаются в Overlay
+    // снимка до следующего переноса. Прежний снимок разрушается в фоне, поэтому пауза на вызывающем
+    // потоке пропорциональна только числу изменений за время переноса
+    void install() {
+        Built built = next.get();
+        std::unordered_set<int> removedVertices;
+        std::unordered_set<long long> removedEdges;
+        for (int v : pending.removedVertices) {
+            if (!replayedVertices.count(v)) removedVertices.insert(v);
+        }
+        for (long long key : pending.removedEdges) {
+            if (!replayedEdges.count(key)) removedEdges.insert(key);
+        }
+        bool leftovers = !removedVertices.empty() || !removedEdges.empty();
+        if (leftovers && !replaying && layoutOf(built.base) != Layout::Csr) {
+            replaying = true;
+            replayedVertices = removedVertices;
+            replayedEdges = removedEdges;
+            next = std::async(std::launch::async, [built = std::move(built), removedVertices = std::move(removedVertices),
+                                                   removedEdges = std::move(removedEdges)]() mutable {
+                replayRemovals(built, removedVertices, removedEdges);
+                return std::move(built);
+            });
+            return;
+        }
+        replaying = false;
+        replayedVertices.clear();
+        replayedEdges.clear();
+
+        auto snapshot = std::make_shared<Snapshot>();
+        snapshot->base = std::move(built.base);
+        edgeCount = built.edges + pending.added.I.size();
+        if (leftovers || layoutOf(snapshot->base) == Layout::Csr) {
+            snapshot->overlay.added = std::move(pending.added);
+            snapshot->overlay.removedVertices = std::move(removedVertices);
+            snapshot->overlay.removedEdges = std::move(removedEdges);
+        } else {
+            mutateBase(snapshot->base, [&](auto& base) {
+                pending.added.forEachEdge([&](int from, int to, double weight) { base.insertEdge(from, to, weight); });
+                for (int v : pending.added.vertices) base.insertVertex(v);
+            });
+        }
+        pending = Overlay();
+        std::shared_ptr<Snapshot> old = std::move(current);
+        current = std::move(snapshot);
+        if (retired.valid()) retired.wait();
+        retired = std::async(std::launch::async, [old = std::move(old)]() mutable { old.reset(); });
+    }
+
+    // Выбор представления по доле операций в последнем окне и средней степени вершин
+    Layout chooseLayout() const {
+        double total = operations;
+        double readShare = (finds + iterations) / total;
+        double insertShare = inserts / total;
+        size_t vertexCount = std::max<size_t>(1, std::visit([](const auto& g) { return g.vertices.size(); },
+                                                            current->base));
+        double averageDegree = static_cast<double>(edgeCount) / vertexCount;
+
+        bool csrAllowed = !negativeVertices; // CSR индексирует массив смещений номером вершины
+        if (csrAllowed && (readShare >= readMostlyShare || (readShare >= 0.7 && averageDegree >= 16))) {
+            return Layout::Csr;
+        }
+        if (insertShare >= ingestShare) return Layout::EdgeList;
+        return Layout::Adjacency;
+    }
+
+    void countOperation(int& counter) {
+        if (next.valid() && next.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+            install();
+        }
+        ++counter;
+        if (++operations < window) return;
+
+        Layout target = chooseLayout();
+        // Overlay поверх CSR сворачивается, когда разрастается; поверх изменяемой основы — сразу
+        bool foldOverlay = layout() == Layout::Csr
+                           ? current->overlay.added.I.size() + current->overlay.removedEdges.size() > edgeCount / 4
+                           : !current->overlay.empty();
+        if (!next.valid() && (edgeCount >= minEdges || foldOverlay) && (target != layout() || foldOverlay)) {
+            std::shared_ptr<const Snapshot> frozen = current;
+            next = std::async(std::launch::async, [frozen, target] { return materialize(*frozen, target); });
+        }
+        inserts = removes = finds = iterations = operations = 0;
+    }
+};
+
+// Битовая карта вершин с рангами для перенумерации. Бит вершины — её позиция в множестве номеров:
+// на отрезке [low, high] — смещение от low; над упорядоченным списком номеров — индекс в нём
+// (двоичный поиск), чтобы память не зависела от разброса номеров
+class VertexBitmap {
+public:
+    VertexBitmap(int low, int high) : low(low), high(high), words(bitCount() / 64 + 1) {
+        clear();
+    }
+
+    // Карта над множеством номеров: отрезок, если он не длиннее 32 номеров на вершину, иначе список
+    explicit VertexBitmap(std::vector<int> ids) {
+        std::sort(ids.begin(), ids.end());
+        ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+        low = ids.empty() ? 0 : ids.front();
+        high = ids.empty() ? -1 : ids.back();
+        if (static_cast<int64_t>(high) - low + 1 > 32 * static_cast<int64_t>(ids.size())) {
+            universe = std::make_shared<const std::vector<int>>(std::move(ids));
+        }
+        words = std::vector<std::atomic<uint64_t>>(bitCount() / 64 + 1);
+        clear();
+    }
+
+    // Позиция вершины в множестве номеров или -1
+    int64_t position(int vertex) const {
+        if (vertex < low || vertex > high) return -1;
+        if (!universe) return static_cast<int64_t>(vertex) - low;
+        auto it = std::lower_bound(universe->begin(), universe->end(), vertex);
+        return it != universe->end() && *it == vertex ? it - universe->begin() : -1;
+    }
+
+    // Число позиций
+    int64_t bitCount() const {
+        return universe ? static_cast<int64_t>(universe->size()) : std::max<int64_t>(0, static_cast<int64_t>(high) - low + 1);
+    }
+
+    bool contains(int vertex) const {
+        return test(position(vertex));
+    }
+
+    bool test(int64_t bit) const {
+        return bit >= 0 && (words[bit >> 6].load(std::memory_order_relaxed) >> (bit & 63)) & 1;
+    }
+
+    // Добавление вершины; безопасно из нескольких потоков. Возвращает true, если вершины не было
+    bool insert(int vertex) {
+        return set(position(vertex));
+    }
+
+    bool set(int64_t bit) {
+        if (bit < 0) return false;
+        uint64_t mask = uint64_t(1) << (bit & 63);
+        return !(words[bit >> 6].fetch_or(mask, std::memory_order_relaxed) & mask);
+    }
+
+    // Построение рангов: новый номер вершины — число отмеченных вершин с меньшим номером
+    void buildRanks() {
+        ranks.assign(words.size() + 1, 0);
+        for (size_t w = 0; w < words.size(); ++w) {
+            ranks[w + 1] = ranks[w] + __builtin_popcountll(words[w].load(std::memory_order_relaxed));
+        }
+    }
+
+    int rank(int vertex) const {
+        int64_t bit = position(vertex);
+        uint64_t below = words[bit >> 6].load(std::memory_order_relaxed) & ((uint64_t(1) << (bit & 63)) - 1);
+        return ranks[bit >> 6] + __builtin_popcountll(below);
+    }
+
+    // Номер вершины по позиции
+    int vertexAt(int64_t bit) const {
+        return universe ? (*universe)[bit] : static_cast<int>(low + bit);
+    }
+
+    // Обход отмеченных вершин по возрастанию номеров
+    template<class F>
+    void forEach(F f) const {
+        for (size_t w = 0; w < words.size(); ++w) {
+            for (uint64_t word = words[w].load(std::memory_order_relaxed); word; word &= word - 1) {
+                f(vertexAt(static_cast<int64_t>(w) * 64 + __builtin_ctzll(word)));
+            }
+        }
+    }
+
+private:
+    int low = 0, high = -1;
+    std::shared_ptr<const std::vector<int>> universe; // Упорядоченные номера; nullptr — отрезок [low, high]
+    std::vector<std::atomic<uint64_t>> words;
+    std::vector<int> ranks;
+
+    void clear() {
+        for (auto& word : words) word.store(0, std::memory_order_relaxed);
+    }
+};
+
+// Подграф с компактными номерами вершин 0..n-1
+struct Subgraph {
+    EdgeListGraph graph;
+    std::vector<int> originalId; // Исходный номер вершины по новому номеру
+};
+
+// Подграф, порождённый отмеченными вершинами: один параллельный проход по дугам
+Subgraph extractInducedSubgraph(const EdgeListGraph& g, VertexBitmap& members, unsigned threads = hardwareThreads()) {
+    Subgraph result{EdgeListGraph(g.undirected), {}};
+    members.buildRanks();
+    members.forEach([&](int v) {
+        if (g.findVertex(v)) result.originalId.push_back(v);
+    });
+    // Отмеченные номера без вершины в графе не получают новых номеров
+    VertexBitmap present(result.originalId);
+    for (int v : result.originalId) present.insert(v);
+    present.buildRanks();
+
+    size_t n = g.I.size();
+    threads = std::max(1u, std::min<unsigned>(threads, n / 4096 + 1));
+    std::vector<std::vector<int>> kept(threads);
+    parallelFor(n, threads, [&](size_t begin, size_t end, unsigned t) {
+        for (size_t k = begin; k < end; ++k) {
+            if (present.contains(g.I[k]) && present.contains(g.J[k])) kept[t].push_back(k);
+        }
+    });
+
+    std::vector<int> selected;
+    for (const auto& part : kept) selected.insert(selected.end(), part.begin(), part.end());
+    EdgeListGraph& sub = result.graph;
+    sub.I.resize(selected.size());
+    sub.J.resize(selected.size());
+    sub.weights.resize(selected.size());
+    parallelFor(selected.size(), threads, [&](size_t begin, size_t end, unsigned) {
+        for (size_t k = begin; k < end; ++k) {
+            int e = selected[k];
+            sub.I[k] = present.rank(g.I[e]);
+            sub.J[k] = present.rank(g.J[e]);
+            sub.weights[k] = g.weights[e];
+        }
+    });
+    sub.edgeProperties = g.edgeProperties.selected(selected);
+    for (size_t v = 0; v < result.originalId.size(); ++v) sub.insertVertex(v);
+    return result;
+}
+
+// Подграф, порождённый множеством вершин
+Subgraph extractInducedSubgraph(const EdgeListGraph& g, const std::vector<int>& vertexSet,
+                                unsigned threads = hardwareThreads()) {
+    if (vertexSet.empty()) return Subgraph{EdgeListGraph(g.undirected), {}};
+    VertexBitmap members(vertexSet);
+    for (int v : vertexSet) members.insert(v);
+    return extractInducedSubgraph(g, members, threads);
+}
+
+// Окрестность вершины радиуса hops (по исходящим дугам; для неориентированного графа — по рёбрам).
+// Дуги один раз раскладываются по позициям начальных вершин (подсчётом, O(V + E)), затем каждый
+// уровень параллельно просматривает только дуги своего фронта
+Subgraph extractEgoNetwork(const EdgeListGraph& g, int seed, int hops, unsigned threads = hardwareThreads()) {
+    if (!g.findVertex(seed)) return Subgraph{EdgeListGraph(g.undirected), {}};
+    VertexBitmap visited(std::vector<int>(g.vertices.begin(), g.vertices.end()));
+    visited.insert(seed);
+    if (hops <= 0) return extractInducedSubgraph(g, visited, threads);
+
+    // Соседи по позициям: соседи позиции p — neighbors[offsets[p], offsets[p + 1])
+    std::vector<int> offsets(visited.bitCount() + 1, 0);
+    std::vector<int> neighbors;
+    auto forEachArc = [&](auto f) {
+        for (size_t k = 0; k < g.I.size(); ++k) {
+            int64_t from = visited.position(g.I[k]), to = visited.position(g.J[k]);
+            if (from < 0 || to < 0) continue;
+            f(from, to);
+            if (g.undirected && from != to) f(to, from);
+        }
+    };
+    forEachArc([&](int64_t from, int64_t) { ++offsets[from + 1]; });
+    for (size_t p = 1; p < offsets.size(); ++p) offsets[p] += offsets[p - 1];
+    neighbors.resize(offsets.back());
+    {
+        std::vector<int> fill(offsets.begin(), offsets.end() - 1);
+        forEachArc([&](int64_t from, int64_t to) { neighbors[fill[from]++] = to; });
+    }
+
+    std::vector<int> frontier = {static_cast<int>(visited.position(seed))};
+    for (int level = 0; level < hops && !frontier.empty(); ++level) {
+        unsigned levelThreads = std::max(1u, std::min<unsigned>(threads, frontier.size() / 256 + 1));
+        std::vector<std::vector<int>> found(levelThreads);
+        parallelFor(frontier.size(), levelThreads, [&](size_t begin, size_t end, unsigned t) {
+            for (size_t k = begin; k < end; ++k) {
+                for (int e = offsets[frontier[k]]; e < offsets[frontier[k] + 1]; ++e) {
+                    if (visited.set(neighbors[e])) found[t].push_back(neighbors[e]);
+                }
+            }
+        });
+        frontier.clear();
+        for (const auto& part : found) frontier.insert(frontier.end(), part.begin(), part.end());
+    }
+    return extractInducedSubgraph(g, visited, threads);
+}
+
+// Временной граф: у каждой дуги есть момент времени, дуги вершины хранятся упорядоченными по времени
+class TemporalEdgeListGraph {
+public:
+    // Пучок исходящих дуг вершины в виде структуры массивов, упорядоченной по T
+    struct Bundle {
+        std::vector<long long> T; // Моменты времени дуг
+        std::vector<int> J; // Конечные вершины
+        std::vector<double> weights; // Вес дуг
+        size_t head = 0; // Дуги до head истекли и ждут уплотнения
+
+        size_t size() const {
+            return T.size() - head;
+        }
+    };
+
+    std::unordered_map<int, Bundle> bundles; // Пучки по начальной вершине
+    std::unordered_set<int> vertices; // Уникальные вершины
+
+    // Вставка вершины
+    void insertVertex(int vertex) {
+        vertices.insert(vertex);
+    }
+
+    // Вставка дуги; дуги, пришедшие по порядку времени, дописываются в конец пучка
+    void insertEdge(int from, int to, double weight, long long time) {
+        Bundle& b = bundles[from];
+        auto pos = std::upper_bound(b.T.begin() + b.head, b.T.end(), time) - b.T.begin();
+        b.T.insert(b.T.begin() + pos, time);
+        b.J.insert(b.J.begin() + pos, to);
+        b.weights.insert(b.weights.begin() + pos, weight);
+        if (pos == static_cast<long>(b.head)) scheduleExpiry(time, from);
+        insertVertex(from);
+        insertVertex(to);
+    }
+
+    // Удаление всех дуг (from, to)
+    void removeEdge(int from, int to) {
+        auto it = bundles.find(from);
+        if (it != bundles.end()) eraseIf(from, it->second, [to](const Bundle& b, size_t k) { return b.J[k] == to; });
+    }
+
+    // Удаление вершины и всех её инцидентных дуг
+    void removeVertex(int vertex) {
+        bundles.erase(vertex);
+        for (auto& [from, b] : bundles) {
+            eraseIf(from, b, [vertex](const Bundle& bundle, size_t k) { return bundle.J[k] == vertex; });
+        }
+        vertices.erase(vertex);
+    }
+
+    // Поиск вершины
+    bool findVertex(int vertex) const {
+        return vertices.find(vertex) != vertices.end();
+    }
+
+    // Поиск дуги в окне времени [t1, t2]
+    bool findEdge(int from, int to, long long t1, long long t2) const {
+        auto it = bundles.find(from);
+        if (it == bundles.end()) return false;
+        const Bundle& b = it->second;
+        size_t k = std::lower_bound(b.T.begin() + b.head, b.T.end(), t1) - b.T.begin();
+        for (; k < b.T.size() && b.T[k] <= t2; ++k) {
+            if (b.J[k] == to) return true;
+        }
+        return false;
+    }
+
+    // Обход дуг вершины в окне времени [t1, t2] по возрастанию времени: f(to, weight, time)
+    template<class F>
+    void forEachNeighborInWindow(int vertex, long long t1, long long t2, F f) const {
+        auto it = bundles.find(vertex);
+        if (it == bundles.end()) return;
+        const Bundle& b = it->second;
+        size_t k = std::lower_bound(b.T.begin() + b.head, b.T.end(), t1) - b.T.begin();
+        for (; k < b.T.size() && b.T[k] <= t2; ++k) {
+            f(b.J[k], b.weights[k], b.T[k]);
+        }
+    }
+
+    // Удаление дуг старше horizon; затрагиваются только пучки, в которых есть истёкшие дуги
+    void expire(long long horizon) {
+        while (!expiryQueue.empty() && expiryQueue.top().first < horizon) {
+            auto [time, from] = expiryQueue.top();
+            expiryQueue.pop();
+            auto it = bundles.find(from);
+            if (it == bundles.end() || it->second.size() == 0 || it->second.T[it->second.head] != time) {
+                continue; // Устаревшая запись очереди
+            }
+            Bundle& b = it->second;
+            b.head = std::lower_bound(b.T.begin() + b.head, b.T.end(), horizon) - b.T.begin();
+            compact(b);
+            if (b.size() > 0) scheduleExpiry(b.T[b.head], from);
+        }
+    }
+
+    // Печать всех дуг
+    void printEdges() const {
+        for (const auto& [from, b] : bundles) {
+            for (size_t k = b.head; k < b.T.size(); ++k) {
+                std::cout << "Edge: " << from << " -> " << b.J[k] << ", Weight: " << b.weights[k]
+                          << ", Time: " << b.T[k] << "\n";
+            }
+        }
+    }
+
+private:
+    // Очередь (самое раннее время пучка, вершина) для истечения; записи могут устаревать
+    std::priority_queue<std::pair<long long, int>, std::vector<std::pair<long long, int>>, std::greater<>> expiryQueue;
+
+    // Запись нового самого раннего времени пучка. Когда устаревших записей становится больше живых
+    // (по одной на непустой пучок), очередь перестраивается по пучкам
+    void scheduleExpiry(long long time, int from) {
+        expiryQueue.emplace(time, from);
+        if (expiryQueue.size() <= 2 * bundles.size() + 64) return;
+        std::vector<std::pair<long long, int>> live;
+        live.reserve(bundles.size());
+        for (const auto& [vertex, b] : bundles) {
+            if (b.size() > 0) live.emplace_back(b.T[b.head], vertex);
+        }
+        expiryQueue = decltype(expiryQueue)(std::greater<>(), std::move(live));
+    }
+
+    // Уплотнение пучка, когда истёкших дуг больше половины
+    static void compact(Bundle& b) {
+        if (b.head < 64 || b.head * 2 < b.T.size()) return;
+        b.T.erase(b.T.begin(), b.T.begin() + b.head);
+        b.J.erase(b.J.begin(), b.J.begin() + b.head);
+        b.weights.erase(b.weights.begin(), b.weights.begin() + b.head);
+        b.head = 0;
+    }
+
+    // Удаление дуг пучка по условию; очередь истечения пополняется, только если изменилось самое раннее время
+    template<class Predicate>
+    void eraseIf(int from, Bundle& b, Predicate remove) {
+        long long earliest = b.size() > 0 ? b.T[b.head] : LLONG_MIN;
+        size_t out = b.head;
+        for (size_t k = b.head; k < b.T.size(); ++k) {
+            if (remove(b, k)) continue;
+            b.T[out] = b.T[k];
+            b.J[out] = b.J[k];
+            b.weights[out] = b.weights[k];
+            ++out;
+        }
+        b.T.resize(out);
+        b.J.resize(out);
+        b.weights.resize(out);
+        if (b.size() > 0 && b.T[b.head] != earliest) scheduleExpiry(b.T[b.head], from);
+    }
+};
+
+// Динамический граф на упакованном массиве (PMA): дуги хранятся упорядоченными по (from, to)
+// сегментами с пропусками; вставка и удаление — O(log² n) амортизированно, обход пучка — последовательный
+class PackedMemoryArrayGraph {
+public:
+    std::unordered_set<int> vertices; // Уникальные вершины
+
+    PackedMemoryArrayGraph() {
+        layout({}, {}, minCapacity);
+    }
+
+    // Число дуг
+    size_t edgeCount() const {
+        return total;
+    }
+
+    // Вставка вершины
+    void insertVertex(int vertex) {
+        vertices.insert(vertex);
+    }
+
+    // Вставка дуги
+    void insertEdge(int from, int to, double weight) {
+        uint64_t key = edgeKey(from, to);
+        size_t s = findSegment(key);
+        if (static_cast<size_t>(counts[s]) < segmentSize) {
+            insertIntoSegment(s, key, weight);
+            ++total;
+        } else {
+            rebalanceForInsert(s, key, weight);
+        }
+        insertVertex(from);
+        insertVertex(to);
+    }
+
+    // Пакетная вставка дуг
+    void insertEdges(const std::vector<int>& from, const std::vector<int>& to, const std::vector<double>& weight) {
+        checkEdgeBatch(from, to, weight);
+        for (size_t k = 0; k < from.size(); ++k) insertEdge(from[k], to[k], weight[k]);
+    }
+
+    // Удаление всех дуг (from, to)
+    void removeEdge(int from, int to) {
+        uint64_t key = edgeKey(from, to);
+        while (true) {
+            size_t s = findSegment(key);
+            size_t base = s * segmentSize;
+            auto end = keys.begin() + base + counts[s];
+            auto it = std::lower_bound(keys.begin() + base, end, key);
+            if (it == end || *it != key) return;
+            eraseFromSegment(s, it - keys.begin());
+        }
+    }
+
+    // Удаление вершины и всех её инцидентных дуг: перестроение массива за O(E)
+    void removeVertex(int vertex) {
+        std::vector<uint64_t> keptKeys;
+        std::vector<double> keptWeights;
+        forEachSlot([&](uint64_t key, double weight) {
+            if (keyFrom(key) != vertex && keyTo(key) != vertex) {
+                keptKeys.push_back(key);
+                keptWeights.push_back(weight);
+            }
+        });
+        layout(std::move(keptKeys), std::move(keptWeights), capacity());
+        vertices.erase(vertex);
+    }
+
+    // Поиск вершины
+    bool findVertex(int vertex) const {
+        return vertices.find(vertex) != vertices.end();
+    }
+
+    // Поиск дуги
+    bool findEdge(int from, int to) const {
+        uint64_t key = edgeKey(from, to);
+        size_t s = findSegment(key);
+        auto begin = keys.begin() + s * segmentSize;
+        return std::binary_search(begin, begin + counts[s], key);
+    }
+
+    // Обход всех дуг по возрастанию (from, to): f(from, to, weight)
+    template<class F>
+    void forEachEdge(F f) const {
+        forEachSlot([&](uint64_t key, double weight) { f(keyFrom(key), keyTo(key), weight); });
+    }
+
+    // Обход пучка дуг вершины — последовательный проход по массиву: f(to, weight)
+    template<class F>
+    void forEachNeighbor(int vertex, F f) const {
+        uint64_t low = edgeKey(vertex, INT_MIN);
+        size_t s = findSegment(low);
+        size_t k = std::lower_bound(keys.begin() + s * segmentSize,
+                                    keys.begin() + s * segmentSize + counts[s], low) - keys.begin() - s * segmentSize;
+        for (; s < counts.size(); ++s, k = 0) {
+            for (; k < static_cast<size_t>(counts[s]); ++k) {
+                uint64_t key = keys[s * segmentSize + k];
+                if ((key >> 32) != (low >> 32)) return;
+                f(keyTo(key), weights[s * segmentSize + k]);
+            }
+        }
+    }
+
+    // Печать всех дуг
+    void printEdges() const {
+        forEachEdge([](int from, int to, double weight) {
+            std::cout << "Edge: " << from << " -> " << to << ", Weight: " << weight << "\n";
+        });
+    }
+
+private:
+    static constexpr size_t minCapacity = 64;
+
+    std::vector<uint64_t> keys; // Ключи дуг (edgeKey); сегмент s занимает [s * segmentSize, (s + 1) * segmentSize)
+    std::vector<double> weights; // Вес дуг в тех же ячейках
+    std::vector<int> counts; // Число дуг в сегменте; дуги прижаты к началу сегмента
+    // Первый ключ сегмента; у пустого — первый ключ следующего непустого (UINT64_MAX, если его нет).
+    // Массив не убывает, поэтому сегмент ищется одним двоичным поиском
+    std::vector<uint64_t> separators;
+    size_t segmentSize = 8;
+    size_t total = 0;
+
+    static int keyFrom(uint64_t key) {
+        return static_cast<int>(static_cast<uint32_t>(key >> 32) ^ 0x80000000u);
+    }
+
+    static int keyTo(uint64_t key) {
+        return static_cast<int>(static_cast<uint32_t>(key) ^ 0x80000000u);
+    }
+
+    size_t capacity() const {
+        return keys.size();
+    }
+
+    int height() const {
+        int h = 0;
+        while ((size_t(1) << h) < counts.size()) ++h;
+        return h;
+    }
+
+    // Допустимые плотности окна уровня level: от листа (сегмента) к корню границы сужаются
+    double upperDensity(int level) const {
+        return 1.0 - 0.25 * level / std::max(1, height());
+    }
+
+    double lowerDensity(int level) const {
+        return 0.125 + 0.125 * level / std::max(1, height());
+    }
+
+    template<class F>
+    void forEachSlot(F f) const {
+        for (size_t s = 0; s < counts.size(); ++s) {
+            for (size_t k = s * segmentSize; k < s * segmentSize + counts[s]; ++k) f(keys[k], weights[k]);
+        }
+    }
+
+    // Последний непустой сегмент, первый ключ которого не больше key (или 0)
+    size_t findSegment(uint64_t key) const {
+        size_t s = std::upper_bound(separators.begin(), separators.end(), key) - separators.begin();
+        if (s == 0) return 0;
+        --s;
+        // Пустой сегмент здесь возможен только в хвосте массива при key == UINT64_MAX
+        while (s > 0 && counts[s] == 0) --s;
+        return s;
+    }
+
+    // Пересчёт разделителей сегментов [first, last) и предшествующих им пустых сегментов
+    void refreshSeparators(size_t first, size_t last) {
+        uint64_t next = last < counts.size() ? separators[last] : UINT64_MAX;
+        for (size_t s = last; s-- > first;) {
+            if (counts[s] > 0) next = keys[s * segmentSize];
+            separators[s] = next;
+        }
+        for (size_t s = first; s-- > 0 && counts[s] == 0;) separators[s] = next;
+    }
+
+    void insertIntoSegment(size_t s, uint64_t key, double weight) {
+        size_t base = s * segmentSize;
+        size_t pos = std::upper_bound(keys.begin() + base, keys.begin() + base + counts[s], key) - keys.begin();
+        for (size_t k = base + counts[s]; k > pos; --k) {
+            keys[k] = keys[k - 1];
+            weights[k] = weights[k - 1];
+        }
+        keys[pos] = key;
+        weights[pos] = weight;
+        ++counts[s];
+        if (pos == base) refreshSeparators(s, s + 1);
+    }
+
+    void eraseFromSegment(size_t s, size_t pos) {
+        size_t end = s * segmentSize + counts[s];
+        for (size_t k = pos; k + 1 < end; ++k) {
+            keys[k] = keys[k + 1];
+            weights[k] = weights[k + 1];
+        }
+        --counts[s];
+        --total;
+        if (pos == s * segmentSize) refreshSeparators(s, s + 1);
+        if (counts[s] >= lowerDensity(0) * segmentSize || counts.size() == 1) return;
+
+        // Поиск наименьшего окна с допустимой плотностью и равномерное перераспределение
+        for (int level = 1; level <= height(); ++level) {
+            size_t window = size_t(1) << level;
+            size_t first = s & ~(window - 1);
+            size_t count = windowCount(first, window);
+            if (count >= lowerDensity(level) * window * segmentSize) {
+                std::vector<uint64_t> k;
+                std::vector<double> w;
+                collect(first, window, k, w);
+                spread(first, window, k, w);
+                return;
+            }
+        }
+        std::vector<uint64_t> k;
+        std::vector<double> w;
+        collect(0, counts.size(), k, w);
+        layout(std::move(k), std::move(w), std::max(minCapacity, capacity() / 2));
+    }
+
+    void rebalanceForInsert(size_t s, uint64_t key, double weight) {
+        for (int level = 1; level <= height(); ++level) {
+            size_t window = size_t(1) << level;
+            size_t first = s & ~(window - 1);
+            size_t count = windowCount(first, window) + 1;
+            if (count <= upperDensity(level) * window * segmentSize) {
+                std::vector<uint64_t> k;
+                std::vector<double> w;
+                collect(first, window, k, w);
+                insertSorted(k, w, key, weight);
+                spread(first, window, k, w);
+                ++total;
+                return;
+            }
+        }
+        // Корень переполнен — удвоение ёмкости
+        std::vector<uint64_t> k;
+        std::vector<double> w;
+        collect(0, counts.size(), k, w);
+        insertSorted(k, w, key, weight);
+        layout(std::move(k), std::move(w), capacity() * 2);
+    }
+
+    size_t windowCount(size_t first, size_t window) const {
+        size_t count = 0;
+        for (size_t s = first; s < first + window; ++s) count += counts[s];
+        return count;
+    }
+
+    static void insertSorted(std::vector<uint64_t>& k, std::vector<double>& w, uint64_t key, double weight) {
+        size_t pos = std::upper_bound(k.begin(), k.end(), key) - k.begin();
+        k.insert(k.begin() + pos, key);
+        w.insert(w.begin() + pos, weight);
+    }
+
+    void collect(size_t first, size_t window, std::vector<uint64_t>& k, std::vector<double>& w) const {
+        for (size_t s = first; s < first + window; ++s) {
+            k.insert(k.end(), keys.begin() + s * segmentSize, keys.begin() + s * segmentSize + counts[s]);
+            w.insert(w.end(), weights.begin() + s * segmentSize, weights.begin() + s * segmentSize + counts[s]);
+        }
+    }
+
+    // Равномерное размещение упорядоченных дуг по сегментам окна
+    void spread(size_t first, size_t window, const std::vector<uint64_t>& k, const std::vector<double>& w) {
+        size_t next = 0;
+        for (size_t s = 0; s < window; ++s) {
+            size_t count = k.size() * (s + 1) / window - k.size() * s / window;
+            size_t base = (first + s) * segmentSize;
+            std::copy(k.begin() + next, k.begin() + next + count, keys.begin() + base);
+            std::copy(w.begin() + next, w.begin() + next + count, weights.begin() + base);
+            counts[first + s] = count;
+            next += count;
+        }
+        refreshSeparators(first, first + window);
+    }
+
+    // Новый массив ёмкости newCapacity; размер сегмента ~ log2(ёмкости)
+    void layout(std::vector<uint64_t> k, std::vector<double> w, size_t newCapacity) {
+        size_t logCapacity = 0;
+        while ((size_t(1) << logCapacity) < newCapacity) ++logCapacity;
+        segmentSize = 8;
+        while (segmentSize < logCapacity) segmentSize *= 2;
+        keys.assign(newCapacity, 0);
+        weights.assign(newCapacity, 0.0);
+        counts.assign(newCapacity / segmentSize, 0);
+        separators.assign(counts.size(), UINT64_MAX);
+        total = k.size();
+        spread(0, counts.size(), k, w);
+    }
+};
+
+// Разбор списка CPU вида "0-3,8-11"
+std::vector<int> parseCpuList(const std::string& list) {
+    std::vector<int> cpus;
+    size_t pos = 0;
+    while (pos < list.size()) {
+        size_t end = list.find(',', pos);
+        if (end == std::string::npos) end = list.size();
+        std::string range = list.substr(pos, end - pos);
+        size_t dash = range.find('-');
+        if (!range.empty() && std::isdigit(static_cast<unsigned char>(range[0]))) {
+            int first = std::stoi(range.substr(0, dash));
+            int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+            for (int c = first; c <= last; ++c) cpus.push_back(c);
+        }
+        pos = end + 1;
+    }
+    return cpus;
+}
+
+// CPU каждого узла NUMA; без сведений о топологии — один узел со всеми CPU
+std::vector<std::vector<int>> numaTopology() {
+    std::vector<std::pair<int, std::vector<int>>> nodes;
+#ifdef __linux__
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator("/sys/devices/system/node", error)) {
+        std::string name = entry.path().filename().string();
+        if (name.rfind("node", 0) != 0 || name.size() == 4 || !std::isdigit(static_cast<unsigned char>(name[4]))) {
+            continue;
+        }
+        std::ifstream file(entry.path() / "cpulist");
+        std::string list;
+        if (std::getline(file, list) && !parseCpuList(list).empty()) {
+            nodes.emplace_back(std::stoi(name.substr(4)), parseCpuList(list));
+        }
+    }
+#endif
+    std::sort(nodes.begin(), nodes.end());
+    std::vector<std::vector<int>> topology;
+    for (auto& node : nodes) topology.push_back(std::move(node.second));
+    if (topology.empty()) {
+        topology.emplace_back();
+        for (unsigned c = 0; c < hardwareThreads(); ++c) topology.back().push_back(c);
+    }
+    return topology;
+}
+
+// Привязка текущего потока к набору CPU
+inline void pinCurrentThread(const std::vector<int>& cpus) {
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int c : cpus) {
+        if (c < CPU_SETSIZE) CPU_SET(c, &set);
+    }
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+    (void) cpus;
+#endif
+}
+
+// Граф, разбитый по узлам NUMA: каждый узел владеет отрезком номеров вершин и хранит их пучки в CSR.
+// Массивы части выделяет и заполняет поток, привязанный к CPU её узла, поэтому страницы
+// размещаются в памяти этого узла (политика первого касания). Число узлов и потоков задаётся явно,
+// так что разбиение на «виртуальные» узлы проверяется и на одном сокете.
+// Потоки узлов создаются один раз вместе с графом и переиспользуются всеми проходами
+class NumaPartitionedGraph {
 public:
-    std::vector<int> I; // Начальные вершины
-    std::vector<int> J; // Конечные вершины
-    std::vector<double> weights; // Вес дуг
-    std::unordered_set<int> vertices; // Набор для хранения уникальных вершин
+    // Часть графа одного узла
+    struct Partition {
+        int firstVertex = 0; // Отрезок вершин [firstVertex, lastVertex)
+        int lastVertex = 0;
+        std::vector<int> offsets; // Пучок вершины v: [offsets[v - firstVertex], offsets[v - firstVertex + 1])
+        std::vector<int> targets;
+        std::vector<double> weights;
+        std::vector<int> cpus; // CPU узла
+    };
+
+    std::vector<Partition> partitions;
+    int threadsPerNode;
+
+    // Номера вершин неотрицательны (иначе std::invalid_argument); рёбра неориентированного графа
+    // хранятся в пучках обоих концов. nodes = 0 — по числу узлов машины, threadsPerNode = 0 — по числу CPU узла
+    explicit NumaPartitionedGraph(const EdgeListGraph& g, int nodes = 0, int threadsPerNode = 0)
+            : threadsPerNode(threadsPerNode) {
+        int vertexSlots = 0;
+        for (int v : g.vertices) {
+            if (v < 0) throw std::invalid_argument("NumaPartitionedGraph requires non-negative vertex ids");
+            vertexSlots = std::max(vertexSlots, v + 1);
+        }
+        for (size_t k = 0; k < g.I.size(); ++k) {
+            if (g.I[k] < 0 || g.J[k] < 0) throw std::invalid_argument("NumaPartitionedGraph requires non-negative vertex ids");
+            vertexSlots = std::max(vertexSlots, std::max(g.I[k], g.J[k]) + 1);
+        }
+
+        auto topology = numaTopology();
+        if (nodes <= 0) nodes = topology.size();
+        partitions.resize(nodes);
+        assignCpus(topology);
+        std::vector<std::vector<int>> nodeCpus;
+        for (const auto& part : partitions) nodeCpus.push_back(part.cpus);
+        workers = std::make_unique<NodeWorkers>(nodeCpus, this->threadsPerNode);
+
+        // Отрезки вершин с примерно равным числом дуг
+        std::vector<size_t> degreePrefix(vertexSlots + 1, 0);
+        forEachArc(g, [&](size_t, int from, int) { ++degreePrefix[from + 1]; });
+        for (int v = 0; v < vertexSlots; ++v) degreePrefix[v + 1] += degreePrefix[v];
+        int vertex = 0;
+        for (int p = 0; p < nodes; ++p) {
+            partitions[p].firstVertex = vertex;
+            size_t target = (degreePrefix[vertexSlots] * (p + 1) + nodes - 1) / nodes;
+            while (vertex < vertexSlots && (p == nodes - 1 || degreePrefix[vertex + 1] <= target)) ++vertex;
+            partitions[p].lastVertex = vertex;
+        }
+
+        // Построение каждой части потоком её узла
+        runOnNodes([&](int p, int thread) {
+            if (thread == 0) buildPartition(partitions[p], g);
+        }, 1);
+    }
+
+    // Число узлов
+    int nodeCount() const {
+        return partitions.size();
+    }
+
+    // Узел-владелец вершины (или -1)
+    int ownerOf(int vertex) const {
+        auto it = std::upper_bound(partitions.begin(), partitions.end(), vertex,
+                                   [](int v, const Partition& part) { return v < part.lastVertex; });
+        return it == partitions.end() || vertex < it->firstVertex ? -1 : it - partitions.begin();
+    }
+
+    // Обход пучка дуг вершины: f(to, weight)
+    template<class F>
+    void forEachNeighbor(int vertex, F f) const {
+        int p = ownerOf(vertex);
+        if (p < 0) return;
+        const Partition& part = partitions[p];
+        for (int k = part.offsets[vertex - part.firstVertex]; k < part.offsets[vertex - part.firstVertex + 1]; ++k) {
+            f(part.targets[k], part.weights[k]);
+        }
+    }
+
+    // Поиск дуги
+    bool findEdge(int from, int to) const {
+        bool found = false;
+        forEachNeighbor(from, [&](int v, double) { found = found || v == to; });
+        return found;
+    }
+
+    // Параллельный поиск в ширину по уровням: каждый узел раскрывает только свои вершины,
+    // вершины чужих узлов передаются владельцу пакетами. Возвращает расстояния (-1 — недостижима)
+    std::vector<int> bfs(int source) const {
+        int nodes = nodeCount();
+        int threads = workers->threadsPerNode;
+        std::vector<std::unique_ptr<NodeState>> state(nodes);
+        runOnNodes([&](int p, int thread) {
+            if (thread != 0) return;
+            // Расстояния и буферы узла размещаются в его памяти
+            state[p] = std::make_unique<NodeState>(partitions[p].lastVertex - partitions[p].firstVertex, nodes, threads);
+        }, 1);
+
+        int owner = ownerOf(source);
+        if (owner >= 0) {
+            state[owner]->distance[source - partitions[owner].firstVertex] = 0;
+            state[owner]->frontier.push_back(source);
+        }
+        for (int level = 0;; ++level) {
+            bool any = false;
+            for (const auto& s : state) any = any || !s->frontier.empty();
+            if (!any) break;
+
+            // Раскрытие локального фронта: соседи раскладываются по узлам-владельцам
+            runOnNodes([&](int p, int thread) {
+                const Partition& part = partitions[p];
+                NodeState& s = *state[p];
+                auto& outgoing = s.outgoing[thread];
+                for (auto& buffer : outgoing) buffer.clear();
+                size_t begin = s.frontier.size() * thread / threads, end = s.frontier.size() * (thread + 1) / threads;
+                for (size_t k = begin; k < end; ++k) {
+                    int v = s.frontier[k] - part.firstVertex;
+                    for (int e = part.offsets[v]; e < part.offsets[v + 1]; ++e) {
+                        int q = ownerOf(part.targets[e]);
+                        if (q >= 0) outgoing[q].push_back(part.targets[e]);
+                    }
+                }
+            }, threads);
+
+            // Приём пакетов: новые вершины своего отрезка образуют следующий фронт
+            runOnNodes([&](int p, int thread) {
+                const Partition& part = partitions[p];
+                NodeState& s = *state[p];
+                auto& next = s.next[thread];
+                next.clear();
+                for (int q = thread; q < nodes * threads; q += threads) {
+                    for (int v : state[q / threads]->outgoing[q % threads][p]) {
+                        int expected = -1;
+                        if (s.distance[v - part.firstVertex].compare_exchange_strong(expected, level + 1)) {
+                            next.push_back(v);
+                        }
+                    }
+                }
+            }, threads);
+
+            for (auto& s : state) {
+                s->frontier.clear();
+                for (auto& part : s->next) s->frontier.insert(s->frontier.end(), part.begin(), part.end());
+            }
+        }
+
+        std::vector<int> distance(partitions.empty() ? 0 : partitions.back().lastVertex, -1);
+        for (int p = 0; p < nodes; ++p) {
+            for (size_t v = 0; v < state[p]->distance.size(); ++v) {
+                distance[partitions[p].firstVertex + v] = state[p]->distance[v].load();
+            }
+        }
+        return distance;
+    }
+
+private:
+    // Постоянные потоки узлов, привязанные к их CPU: run выполняет f(узел, поток) во всех потоках и ждёт их
+    class NodeWorkers {
+    public:
+        const int threadsPerNode;
+
+        NodeWorkers(const std::vector<std::vector<int>>& nodeCpus, int threadsPerNode)
+                : threadsPerNode(std::max(1, threadsPerNode)) {
+            for (size_t p = 0; p < nodeCpus.size(); ++p) {
+                for (int t = 0; t < this->threadsPerNode; ++t) {
+                    threads.emplace_back([this, p, t, cpus = nodeCpus[p]] {
+                        pinCurrentThread(cpus);
+                        work(p, t);
+                    });
+                }
+            }
+        }
+
+        ~NodeWorkers() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            started.notify_all();
+            for (auto& thread : threads) thread.join();
+        }
+
+        void run(const std::function<void(int, int)>& f) {
+            std::lock_guard<std::mutex> serial(runMutex);
+            std::unique_lock<std::mutex> lock(mutex);
+            task = &f;
+            pending = threads.size();
+            ++generation;
+            started.notify_all();
+            finished.wait(lock, [&] { return pending == 0; });
+            task = nullptr;
+        }
+
+    private:
+        std::vector<std::thread> threads;
+        std::mutex runMutex; // Проходы разных вызывающих потоков выполняются по очереди
+        std::mutex mutex;
+        std::condition_variable started, finished;
+        const std::function<void(int, int)>* task = nullptr;
+        size_t pending = 0;
+        uint64_t generation = 0;
+        bool stopping = false;
+
+        void work(int p, int t) {
+            uint64_t seen = 0;
+            std::unique_lock<std::mutex> lock(mutex);
+            while (true) {
+                started.wait(lock, [&] { return stopping || generation != seen; });
+                if (stopping) return;
+                seen = generation;
+                const auto* f = task;
+                lock.unlock();
+                (*f)(p, t);
+                lock.lock();
+                if (--pending == 0) finished.notify_one();
+            }
+        }
+    };
+
+    std::unique_ptr<NodeWorkers> workers;
+
+    // Состояние поиска в ширину на одном узле
+    struct NodeState {
+        std::vector<std::atomic<int>> distance;
+        std::vector<int> frontier;
+        std::vector<std::vector<std::vector<int>>> outgoing; // [поток][узел-получатель]
+        std::vector<std::vector<int>> next; // Следующий фронт по потокам
+
+        NodeState(int vertices, int nodes, int threads)
+                : distance(vertices), outgoing(threads, std::vector<std::vector<int>>(nodes)), next(threads) {
+            for (auto& d : distance) d.store(-1, std::memory_order_relaxed);
+        }
+    };
+
+    // Раздача CPU узлам; при числе узлов больше числа узлов машины CPU делятся между ними по кругу
+    void assignCpus(const std::vector<std::vector<int>>& topology) {
+        int nodes = partitions.size();
+        if (nodes <= static_cast<int>(topology.size())) {
+            for (size_t t = 0; t < topology.size(); ++t) {
+                auto& cpus = partitions[t % nodes].cpus;
+                cpus.insert(cpus.end(), topology[t].begin(), topology[t].end());
+            }
+        } else {
+            std::vector<int> all;
+            for (const auto& node : topology) all.insert(all.end(), node.begin(), node.end());
+            for (int p = 0; p < std::max<int>(nodes, all.size()); ++p) {
+                partitions[p % nodes].cpus.push_back(all[p % all.size()]);
+            }
+        }
+        if (threadsPerNode <= 0) {
+            threadsPerNode = 1;
+            for (const auto& part : partitions) threadsPerNode = std::max<int>(threadsPerNode, part.cpus.size());
+        }
+    }
+
+    // Запуск f(узел, поток) в первых threads потоках каждого узла
+    template<class F>
+    void runOnNodes(F f, int threads) const {
+        workers->run([&](int p, int t) {
+            if (t < threads) f(p, t);
+        });
+    }
+
+    // Обход дуг списка: f(индекс дуги, from, to); ребро неориентированного графа — в обе стороны
+    template<class F>
+    static void forEachArc(const EdgeListGraph& g, F f) {
+        for (size_t k = 0; k < g.I.size(); ++k) {
+            f(k, g.I[k], g.J[k]);
+            if (g.undirected && g.I[k] != g.J[k]) f(k, g.J[k], g.I[k]);
+        }
+    }
+
+    static void buildPartition(Partition& part, const EdgeListGraph& g) {
+        int count = part.lastVertex - part.firstVertex;
+        part.offsets.assign(count + 1, 0);
+        forEachArc(g, [&](size_t, int from, int) {
+            if (from >= part.firstVertex && from < part.lastVertex) ++part.offsets[from - part.firstVertex + 1];
+        });
+        for (int v = 0; v < count; ++v) part.offsets[v + 1] += part.offsets[v];
+        part.targets.resize(part.offsets[count]);
+        part.weights.resize(part.offsets[count]);
+        std::vector<int> pos(part.offsets.begin(), part.offsets.end() - 1);
+        forEachArc(g, [&](size_t k, int from, int to) {
+            if (from >= part.firstVertex && from < part.lastVertex) {
+                int p = pos[from - part.firstVertex]++;
+                part.targets[p] = to;
+                part.weights[p] = g.weights[k];
+            }
+        });
+    }
+};
+
+template<class Graph, class = void>
+struct HasUndirectedFlag : std::false_type {};
+
+template<class Graph>
+struct HasUndirectedFlag<Graph, std::void_t<decltype(std::declval<Graph>().undirected)>> : std::true_type {};
+
+template<class Graph, class = void>
+struct HasSymmetricFlag : std::false_type {};
+
+template<class Graph>
+struct HasSymmetricFlag<Graph, std::void_t<decltype(std::declval<Graph>().symmetric)>> : std::true_type {};
+
+// Хранит ли граф рёбра без направления
+template<class Graph>
+bool isUndirectedGraph(const Graph& g) {
+    if constexpr (HasUndirectedFlag<Graph>::value) {
+        return g.undirected;
+    } else if constexpr (HasSymmetricFlag<Graph>::value) {
+        return g.symmetric;
+    } else {
+        return false;
+    }
+}
+
+// Часть графа после разбиения: свои вершины и таблица призрачных (чужих граничных) вершин
+struct GraphShard {
+    EdgeListGraph graph; // Дуги, исходящие из своих вершин; локальные номера: сначала свои, затем призрачные
+    std::vector<int> globalId; // Исходный номер вершины по локальному номеру
+    int ownedCount = 0; // Локальные номера [0, ownedCount) — свои вершины
+    std::vector<int> ghostOwner; // Часть-владелец призрачной вершины с локальным номером ownedCount + i
+    std::vector<int> boundary; // Локальные номера своих вершин, смежных с другими частями
+};
+
+// Результат разбиения графа на k частей
+struct GraphPartitioning {
+    std::unordered_map<int, int> partOf; // Часть каждой вершины
+    std::vector<GraphShard> shards;
+    size_t edgeCut = 0; // Число дуг между частями
+};
+
+// Многоуровневое разбиение графа на k частей: огрубление паросочетанием по тяжёлым рёбрам,
+// начальное разбиение самого грубого графа по порядку обхода в ширину и параллельное
+// уточнение распространением меток на каждом уровне. Направление дуг при разбиении не учитывается.
+// Дуги с концом вне g.vertices (висячие, например после BundledEdgeListGraph::removeVertex) пропускаются
+// Ребро неориентированного графа (isUndirectedGraph) попадает в части обоих концов двумя дугами
+template<class Graph>
+GraphPartitioning partitionGraph(const Graph& g, int k, unsigned threads = hardwareThreads(), double imbalance = 0.03) {
+    // Взвешенный неориентированный граф одного уровня огрубления
+    struct Level {
+        std::vector<int> offsets, targets, edgeWeights, vertexWeights;
+        std::vector<int> coarseOf; // Вершина следующего, более грубого уровня
+    };
+    auto buildLevel = [](int n, std::vector<std::vector<std::pair<int, int>>>& adjacency, std::vector<int> vertexWeights) {
+        Level level;
+        level.vertexWeights = std::move(vertexWeights);
+        level.offsets.assign(n + 1, 0);
+        for (int u = 0; u < n; ++u) {
+            auto& list = adjacency[u];
+            std::sort(list.begin(), list.end());
+            for (size_t i = 0; i < list.size(); ++i) {
+                if (!level.targets.empty() && i > 0 && list[i].first == list[i - 1].first) {
+                    level.edgeWeights.back() += list[i].second;
+                } else {
+                    level.targets.push_back(list[i].first);
+                    level.edgeWeights.push_back(list[i].second);
+                }
+            }
+            level.offsets[u + 1] = level.targets.size();
+        }
+        return level;
+    };
+
+    GraphPartitioning result;
+    std::vector<int> ids(g.vertices.begin(), g.vertices.end());
+    std::sort(ids.begin(), ids.end());
+    int n = ids.size();
+    k = std::max(1, k);
+    std::unordered_map<int, int> index;
+    for (int i = 0; i < n; ++i) index[ids[i]] = i;
+
+    std::vector<std::vector<std::pair<int, int>>> adjacency(n);
+    g.forEachEdge([&](int from, int to, double) {
+        auto u = index.find(from), v = index.find(to);
+        if (u == index.end() || v == index.end() || u == v) return;
+        adjacency[u->second].emplace_back(v->second, 1);
+        adjacency[v->second].emplace_back(u->second, 1);
+    });
+    std::vector<Level> levels;
+    levels.push_back(buildLevel(n, adjacency, std::vector<int>(n, 1)));
+
+    // Огрубление
+    std::mt19937 random(12345);
+    while (true) {
+        Level& fine = levels.back();
+        int size = fine.vertexWeights.size();
+        if (size <= std::max(30 * k, 64)) break;
+        std::vector<int> order(size), match(size, -1);
+        for (int u = 0; u < size; ++u) order[u] = u;
+        std::shuffle(order.begin(), order.end(), random);
+        for (int u : order) {
+            if (match[u] != -1) continue;
+            int best = u, bestWeight = 0;
+            for (int e = fine.offsets[u]; e < fine.offsets[u + 1]; ++e) {
+                int v = fine.targets[e];
+                if (match[v] == -1 && fine.edgeWeights[e] > bestWeight) {
+                    best = v;
+                    bestWeight = fine.edgeWeights[e];
+                }
+            }
+            match[u] = best;
+            match[best] = u;
+        }
+        fine.coarseOf.assign(size, -1);
+        int coarseSize = 0;
+        for (int u = 0; u < size; ++u) {
+            if (fine.coarseOf[u] == -1) fine.coarseOf[u] = fine.coarseOf[match[u]] = coarseSize++;
+        }
+        if (coarseSize > 0.95 * size) break; // Огрубление почти не уменьшает граф
+
+        std::vector<int> coarseWeights(coarseSize, 0);
+        std::vector<std::vector<std::pair<int, int>>> coarseAdjacency(coarseSize);
+        for (int u = 0; u < size; ++u) {
+            int cu = fine.coarseOf[u];
+            coarseWeights[cu] += fine.vertexWeights[u];
+            for (int e = fine.offsets[u]; e < fine.offsets[u + 1]; ++e) {
+                int cv = fine.coarseOf[fine.targets[e]];
+                if (cu != cv) coarseAdjacency[cu].emplace_back(cv, fine.edgeWeights[e]);
+            }
+        }
+        levels.push_back(buildLevel(coarseSize, coarseAdjacency, std::move(coarseWeights)));
+    }
+
+    // Начальное разбиение самого грубого графа жадным наращиванием: часть растёт от начальной вершины,
+    // каждый раз забирая вершину, сильнее всего связанную с уже набранной частью
+    const Level& coarsest = levels.back();
+    int coarseSize = coarsest.vertexWeights.size();
+    long long totalWeight = n, assignedWeight = 0;
+    std::vector<int> part(coarseSize, -1);
+    std::vector<long long> gain(coarseSize);
+    int nextSeed = 0;
+    for (int p = 0; p < k - 1; ++p) {
+        long long goal = (totalWeight - assignedWeight) / (k - p), weight = 0;
+        std::fill(gain.begin(), gain.end(), 0);
+        std::priority_queue<std::pair<long long, int>> candidates;
+        while (weight < goal) {
+            if (candidates.empty()) {
+                while (nextSeed < coarseSize && part[nextSeed] != -1) ++nextSeed;
+                if (nextSeed == coarseSize) break;
+                candidates.emplace(0, nextSeed);
+            }
+            auto [candidateGain, u] = candidates.top();
+            candidates.pop();
+            if (part[u] != -1 || candidateGain != gain[u]) continue; // Устаревшая запись
+            part[u] = p;
+            weight += coarsest.vertexWeights[u];
+            for (int e = coarsest.offsets[u]; e < coarsest.offsets[u + 1]; ++e) {
+                int v = coarsest.targets[e];
+                if (part[v] != -1) continue;
+                gain[v] += coarsest.edgeWeights[e];
+                candidates.emplace(gain[v], v);
+            }
+        }
+        assignedWeight += weight;
+    }
+    for (int& p : part) {
+        if (p == -1) p = k - 1;
+    }
+
+    // Уточнение распространением меток на каждом уровне, от грубого к исходному
+    long long maxPartWeight = static_cast<long long>((1.0 + imbalance) * totalWeight / k) + 1;
+    for (int l = levels.size() - 1; l >= 0; --l) {
+        const Level& level = levels[l];
+        int size = level.vertexWeights.size();
+        if (l < static_cast<int>(levels.size()) - 1) {
+            std::vector<int> fine(size);
+            for (int u = 0; u < size; ++u) fine[u] = part[level.coarseOf[u]];
+            part.swap(fine);
+        }
+        std::vector<std::atomic<int>> label(size);
+        std::vector<std::atomic<long long>> partWeight(k);
+        for (auto& w : partWeight) w.store(0);
+        for (int u = 0; u < size; ++u) {
+            label[u].store(part[u], std::memory_order_relaxed);
+            partWeight[part[u]] += level.vertexWeights[u];
+        }
+        for (int round = 0; round < 4; ++round) {
+            std::atomic<int> moves{0};
+            parallelFor(size, threads, [&](size_t begin, size_t end, unsigned) {
+                std::vector<long long> connection(k, 0);
+                std::vector<int> touched;
+                for (size_t u = begin; u < end; ++u) {
+                    int current = label[u].load(std::memory_order_relaxed);
+                    touched.clear();
+                    for (int e = level.offsets[u]; e < level.offsets[u + 1]; ++e) {
+                        int p = label[level.targets[e]].load(std::memory_order_relaxed);
+                        if (connection[p] == 0) touched.push_back(p);
+                        connection[p] += level.edgeWeights[e];
+                    }
+                    int best = current;
+                    for (int p : touched) {
+                        if (connection[p] > connection[best]) best = p;
+                    }
+                    for (int p : touched) connection[p] = 0;
+                    if (best == current) continue;
+
+                    int w = level.vertexWeights[u];
+                    if (partWeight[best].fetch_add(w) + w > maxPartWeight) {
+                        partWeight[best].fetch_sub(w); // Перенос нарушил бы баланс
+                        continue;
+                    }
+                    partWeight[current].fetch_sub(w);
+                    label[u].store(best, std::memory_order_relaxed);
+                    ++moves;
+                }
+            });
+            if (moves == 0) break;
+        }
+        for (int u = 0; u < size; ++u) part[u] = label[u].load(std::memory_order_relaxed);
+    }
+
+    // Части с таблицами призрачных вершин
+    for (int i = 0; i < n; ++i) result.partOf[ids[i]] = part[i];
+    result.shards.resize(k);
+    std::vector<std::unordered_map<int, int>> local(k);
+    for (int i = 0; i < n; ++i) {
+        GraphShard& shard = result.shards[part[i]];
+        local[part[i]][ids[i]] = shard.globalId.size();
+        shard.globalId.push_back(ids[i]);
+        shard.graph.insertVertex(shard.ownedCount++);
+    }
+    std::vector<std::vector<char>> onBoundary(k);
+    for (int p = 0; p < k; ++p) onBoundary[p].assign(result.shards[p].ownedCount, 0);
+    // Дуга from -> to в часть p владельца from; to при необходимости становится призрачной вершиной
+    auto addArc = [&](int p, int from, int q, int to, double weight) {
+        GraphShard& shard = result.shards[p];
+        auto [it, added] = local[p].try_emplace(to, shard.globalId.size());
+        if (added) {
+            shard.globalId.push_back(to);
+            shard.ghostOwner.push_back(q);
+        }
+        shard.graph.insertEdge(local[p][from], it->second, weight);
+    };
+    bool undirected = isUndirectedGraph(g);
+    g.forEachEdge([&](int from, int to, double weight) {
+        auto fromPart = result.partOf.find(from), toPart = result.partOf.find(to);
+        if (fromPart == result.partOf.end() || toPart == result.partOf.end()) return;
+        int p = fromPart->second, q = toPart->second;
+        addArc(p, from, q, to, weight);
+        if (undirected && from != to) addArc(q, to, p, from, weight);
+        if (p != q) {
+            ++result.edgeCut;
+            onBoundary[p][local[p][from]] = 1;
+            onBoundary[q][local[q][to]] = 1;
+        }
+    });
+    for (int p = 0; p < k; ++p) {
+        for (int v = 0; v < result.shards[p].ownedCount; ++v) {
+            if (onBoundary[p][v]) result.shards[p].boundary.push_back(v);
+        }
+    }
+    return result;
+}
+
+#ifdef __unix__
+// Разбитый на части граф, каждая часть которого обслуживается отдельным процессом.
+// Процессы связаны с координатором сокетами домена Unix; запрос и ответ — кадр
+// [тип: 1 байт][число элементов: 4 байта][элементы].
+// Координатор может быть многопоточным, поэтому процесс части не продолжает его образ после fork,
+// а сразу запускает заново исполняемый файл (executable) с аргументами workerFlag <сокет>;
+// main передаёт такой запуск в workerMain, а часть графа приходит первым кадром Load
+class ShardedGraphCluster {
+public:
+    static constexpr const char* workerFlag = "--graph-shard-worker";
+
+    explicit ShardedGraphCluster(const GraphPartitioning& partitioning,
+                                 const std::string& executable = "/proc/self/exe") : partOf(partitioning.partOf) {
+        try {
+            for (const GraphShard& shard : partitioning.shards) {
+                spawn(executable);
+                std::vector<char> encoded = encodeShard(shard);
+                sendFrame(sockets.back(), Load, encoded.data(), encoded.size());
+            }
+        } catch (...) {
+            shutdown();
+            throw;
+        }
+    }
+
+    ShardedGraphCluster(const ShardedGraphCluster&) = delete;
+    ShardedGraphCluster& operator=(const ShardedGraphCluster&) = delete;
+
+    ~ShardedGraphCluster() {
+        shutdown();
+    }
+
+    // Точка входа процесса части: приём части графа и обслуживание запросов до Shutdown
+    static int workerMain(int socket) {
+        try {
+            uint8_t type;
+            std::vector<char> encoded = receiveFrame(socket, &type);
+            if (type != Load) return 1;
+            serve(socket, decodeShard(encoded));
+        } catch (const std::runtime_error&) {
+            return 1;
+        }
+        return 0;
+    }
+
+    // Число частей (процессов)
+    int shardCount() const {
+        return sockets.size();
+    }
+
+    // Соседи вершины, запрошенные у процесса-владельца: (to, weight)
+    std::vector<std::pair<int, double>> neighbors(int vertex) {
+        auto it = partOf.find(vertex);
+        if (it == partOf.end()) return {};
+        sendFrame(sockets[it->second], Neighbors, &vertex, sizeof(int));
+        std::vector<char> reply = receiveFrame(sockets[it->second]);
+        std::vector<std::pair<int, double>> result(reply.size() / 12);
+        for (size_t k = 0; k < result.size(); ++k) {
+            std::memcpy(&result[k].first, reply.data() + 12 * k, 4);
+            std::memcpy(&result[k].second, reply.data() + 12 * k + 4, 8);
+        }
+        return result;
+    }
+
+    // Поиск в ширину по уровням: на каждом уровне каждый процесс получает одним пакетом
+    // свои вершины фронта и возвращает одним пакетом их соседей. Возвращает расстояния достигнутых вершин
+    std::unordered_map<int, int> bfs(int source) {
+        std::unordered_map<int, int> distance;
+        if (!partOf.count(source)) return distance;
+        distance[source] = 0;
+        std::vector<std::vector<int>> frontier(sockets.size());
+        frontier[partOf[source]].push_back(source);
+
+        for (int level = 1;; ++level) {
+            // Сначала рассылка всех пакетов, затем приём: части раскрывают фронт одновременно
+            bool any = false;
+            for (size_t p = 0; p < sockets.size(); ++p) {
+                if (frontier[p].empty()) continue;
+                sendFrame(sockets[p], Expand, frontier[p].data(), frontier[p].size() * sizeof(int));
+                any = true;
+            }
+            if (!any) break;
+            std::vector<std::vector<int>> next(sockets.size());
+            for (size_t p = 0; p < sockets.size(); ++p) {
+                if (frontier[p].empty()) continue;
+                std::vector<char> reply = receiveFrame(sockets[p]);
+                for (size_t k = 0; k + 4 <= reply.size(); k += 4) {
+                    int v;
+                    std::memcpy(&v, reply.data() + k, 4);
+                    auto owner = partOf.find(v);
+                    if (owner != partOf.end() && distance.emplace(v, level).second) next[owner->second].push_back(v);
+                }
+            }
+            frontier.swap(next);
+        }
+        return distance;
+    }
+
+private:
+    enum FrameType : uint8_t { Expand, Neighbors, Shutdown, Load };
+
+    std::unordered_map<int, int> partOf;
+    std::vector<int> sockets;
+    std::vector<pid_t> workers;
+
+    // Запуск процесса части: между fork и exec выполняются только async-signal-safe вызовы
+    void spawn(const std::string& executable) {
+        int pair[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, pair) != 0) throw std::runtime_error("socketpair failed");
+        std::string socketArgument = std::to_string(pair[1]);
+        char* argv[] = {const_cast<char*>(executable.c_str()), const_cast<char*>(workerFlag),
+                        const_cast<char*>(socketArgument.c_str()), nullptr};
+        pid_t pid = fork();
+        if (pid < 0) {
+            close(pair[0]);
+            close(pair[1]);
+            throw std::runtime_error("fork failed");
+        }
+        if (pid == 0) {
+            // Сокет части наследуется через exec, остальные закрываются по FD_CLOEXEC
+            fcntl(pair[1], F_SETFD, 0);
+            execv(argv[0], argv);
+            _exit(127);
+        }
+        close(pair[1]);
+        sockets.push_back(pair[0]);
+        workers.push_back(pid);
+    }
+
+    // Остановка процессов частей; ошибки связи не выходят наружу (часть могла уже завершиться)
+    void shutdown() {
+        for (size_t p = 0; p < sockets.size(); ++p) {
+            try {
+                sendFrame(sockets[p], Shutdown, nullptr, 0);
+            } catch (const std::runtime_error&) {
+                // Соединение уже разорвано
+            }
+            close(sockets[p]);
+            waitpid(workers[p], nullptr, 0);
+        }
+        sockets.clear();
+        workers.clear();
+    }
+
+    // Часть графа в кадре Load: ownedCount, число вершин, globalId, число дуг, дуги (from, to, weight)
+    static std::vector<char> encodeShard(const GraphShard& shard) {
+        std::vector<char> data;
+        auto put = [&](const void* value, size_t size) {
+            data.insert(data.end(), static_cast<const char*>(value), static_cast<const char*>(value) + size);
+        };
+        uint32_t ownedCount = shard.ownedCount, vertexCount = shard.globalId.size(), edgeCount = shard.graph.I.size();
+        put(&ownedCount, 4);
+        put(&vertexCount, 4);
+        if (vertexCount > 0) put(shard.globalId.data(), 4 * vertexCount);
+        put(&edgeCount, 4);
+        shard.graph.forEachEdge([&](int from, int to, double weight) {
+            put(&from, 4);
+            put(&to, 4);
+            put(&weight, 8);
+        });
+        return data;
+    }
+
+    static GraphShard decodeShard(const std::vector<char>& data) {
+        size_t position = 0;
+        auto get = [&](void* value, size_t size) {
+            if (position + size > data.size()) throw std::runtime_error("Truncated shard");
+            std::memcpy(value, data.data() + position, size);
+            position += size;
+        };
+        GraphShard shard;
+        uint32_t ownedCount, vertexCount, edgeCount;
+        get(&ownedCount, 4);
+        get(&vertexCount, 4);
+        shard.ownedCount = ownedCount;
+        shard.globalId.resize(vertexCount);
+        if (vertexCount > 0) get(shard.globalId.data(), 4 * vertexCount);
+        for (int v = 0; v < shard.ownedCount; ++v) shard.graph.insertVertex(v);
+        get(&edgeCount, 4);
+        for (uint32_t k = 0; k < edgeCount; ++k) {
+            int from, to;
+            double weight;
+            get(&from, 4);
+            get(&to, 4);
+            get(&weight, 8);
+            shard.graph.insertEdge(from, to, weight);
+        }
+        return shard;
+    }
+
+    // Запись в сокет без SIGPIPE: разорванное соединение — исключение, а не завершение координатора
+    static void writeAll(int socket, const void* data, size_t size) {
+#ifdef MSG_NOSIGNAL
+        const int flags = MSG_NOSIGNAL;
+#else
+        const int flags = 0;
+#endif
+        const char* p = static_cast<const char*>(data);
+        while (size > 0) {
+            ssize_t written = send(socket, p, size, flags);
+            if (written < 0 && errno == EINTR) continue;
+            if (written <= 0) throw std::runtime_error("Shard connection lost");
+            p += written;
+            size -= written;
+        }
+    }
+
+    static bool readAll(int socket, void* data, size_t size) {
+        char* p = static_cast<char*>(data);
+        while (size > 0) {
+            ssize_t received = read(socket, p, size);
+            if (received < 0 && errno == EINTR) continue;
+            if (received <= 0) return false;
+            p += received;
+            size -= received;
+        }
+        return true;
+    }
+
+    static void sendFrame(int socket, uint8_t type, const void* data, uint32_t size) {
+        char header[5];
+        header[0] = static_cast<char>(type);
+        std::memcpy(header + 1, &size, 4);
+        writeAll(socket, header, 5);
+        if (size > 0) writeAll(socket, data, size);
+    }
+
+    static std::vector<char> receiveFrame(int socket, uint8_t* type = nullptr) {
+        char header[5];
+        if (!readAll(socket, header, 5)) throw std::runtime_error("Shard connection lost");
+        uint32_t size;
+        std::memcpy(&size, header + 1, 4);
+        if (type) *type = static_cast<uint8_t>(header[0]);
+        std::vector<char> data(size);
+        if (size > 0 && !readAll(socket, data.data(), size)) throw std::runtime_error("Shard connection lost");
+        return data;
+    }
+
+    // Цикл процесса части: CSR по локальным номерам и ответы на запросы координатора
+    static void serve(int socket, const GraphShard& shard) {
+        CsrGraph csr(shard.graph);
+        std::unordered_map<int, int> localId;
+        for (int v = 0; v < shard.ownedCount; ++v) localId[shard.globalId[v]] = v;
+        try {
+            while (true) {
+                uint8_t type;
+                std::vector<char> request = receiveFrame(socket, &type);
+                std::vector<char> reply;
+                if (type == Shutdown) return;
+                for (size_t k = 0; k + 4 <= request.size(); k += 4) {
+                    int vertex;
+                    std::memcpy(&vertex, request.data() + k, 4);
+                    auto it = localId.find(vertex);
+                    if (it == localId.end()) continue;
+                    csr.forEachNeighbor(it->second, [&](int to, double weight) {
+                        int global = shard.globalId[to];
+                        reply.insert(reply.end(), reinterpret_cast<char*>(&global), reinterpret_cast<char*>(&global) + 4);
+                        if (type == Neighbors) {
+                            reply.insert(reply.end(), reinterpret_cast<char*>(&weight),
+                                         reinterpret_cast<char*>(&weight) + 8);
+                        }
+                    });
+                }
+                sendFrame(socket, type, reply.data(), reply.size());
+            }
+        } catch (const std::runtime_error&) {
+            // Координатор закрыл соединение
+        }
+    }
+};
+#endif
+
+// Граф во внешней памяти: смещения пучков в памяти, пучки дуг на диске блоками по blockEdges дуг.
+// Блоки читаются через кэш с вытеснением CLOCK и фоновой предвыборкой следующих блоков.
+// Файл: "KITX", symmetric, vertexSlots, edgeCount, blockEdges, вершины, смещения,
+// затем с границы 4096 байт блоки [targets][weights]
+class ExternalCsrGraph {
+public:
+    std::vector<uint64_t> offsets; // Начало пучка дуг вершины v: offsets[v], конец: offsets[v + 1]
+    std::unordered_set<int> vertices; // Уникальные вершины
+    bool symmetric = false; // Симметричное представление неориентированного графа
+
+    // Счётчики кэша блоков
+    struct CacheStats {
+        size_t hits = 0; // Блок уже в кэше или загружается предвыборкой
+        size_t misses = 0; // Блок прочитан по требованию
+        size_t prefetched = 0; // Блок прочитан фоновым потоком
+        size_t evictions = 0;
+    };
+
+    // Запись CSR в файл
+    static bool write(const std::string& path, const CsrGraph& g, uint64_t blockEdges = 4096) {
+        std::FILE* file = std::fopen(path.c_str(), "wb");
+        if (!file) return false;
+        const char magic[4] = {'K', 'I', 'T', 'X'};
+        uint64_t header[4] = {g.symmetric, static_cast<uint64_t>(g.vertexSlots()), g.targets.size(), blockEdges};
+        uint64_t vertexCount = g.vertices.size();
+        bool ok = std::fwrite(magic, 1, 4, file) == 4 && std::fwrite(header, 8, 4, file) == 4 &&
+                  std::fwrite(&vertexCount, 8, 1, file) == 1;
+        for (int v : g.vertices) ok = ok && std::fwrite(&v, 4, 1, file) == 1;
+        for (int offset : g.offsets) {
+            uint64_t value = offset;
+            ok = ok && std::fwrite(&value, 8, 1, file) == 1;
+        }
+        long position = std::ftell(file);
+        ok = ok && position >= 0 && std::fseek(file, dataStart(position), SEEK_SET) == 0;
+        for (uint64_t begin = 0; ok && begin < g.targets.size(); begin += blockEdges) {
+            uint64_t count = std::min<uint64_t>(blockEdges, g.targets.size() - begin);
+            ok = std::fwrite(g.targets.data() + begin, 4, count, file) == count &&
+                 std::fwrite(g.weights.data() + begin, 8, count, file) == count;
+        }
+        return std::fclose(file) == 0 && ok;
+    }
+
+    // Открытие файла; cacheBlocks — число блоков в кэше
+    explicit ExternalCsrGraph(const std::string& path, size_t cacheBlocks = 256)
+            : cache(std::make_unique<BlockCache>(std::max<size_t>(cacheBlocks, 4))) {
+        BlockCache& c = *cache;
+        c.file = std::fopen(path.c_str(), "rb");
+        if (!c.file) throw std::runtime_error("Cannot open " + path);
+        char magic[4];
+        uint64_t header[4], vertexCount;
+        if (std::fread(magic, 1, 4, c.file) != 4 || std::memcmp(magic, "KITX", 4) != 0 ||
+            std::fread(header, 8, 4, c.file) != 4 || std::fread(&vertexCount, 8, 1, c.file) != 1 || header[3] == 0) {
+            throw std::runtime_error("Bad external graph file " + path);
+        }
+        symmetric = header[0];
+        c.edgeCount = header[2];
+        c.blockEdges = header[3];
+        for (uint64_t k = 0; k < vertexCount; ++k) {
+            int v;
+            if (std::fread(&v, 4, 1, c.file) != 1) throw std::runtime_error("Bad external graph file " + path);
+            vertices.insert(v);
+        }
+        offsets.resize(header[1] + 1);
+        if (std::fread(offsets.data(), 8, offsets.size(), c.file) != offsets.size()) {
+            throw std::runtime_error("Bad external graph file " + path);
+        }
+        c.dataOffset = dataStart(std::ftell(c.file));
+        c.prefetcher = std::thread([&c] { c.prefetchLoop(); });
+    }
+
+    // Число вершин в массиве смещений
+    int vertexSlots() const {
+        return offsets.size() - 1;
+    }
+
+    // Число хранимых дуг
+    uint64_t edgeCount() const {
+        return cache->edgeCount;
+    }
+
+    // Поиск вершины
+    bool findVertex(int vertex) const {
+        return vertices.find(vertex) != vertices.end();
+    }
+
+    // Поиск дуги двоичным поиском в пучке поблочно (возвращает индекс или -1)
+    long long findEdge(int from, int to) const {
+        if (from < 0 || from >= vertexSlots()) return -1;
+        BlockCache& c = *cache;
+        for (uint64_t p = offsets[from], end = offsets[from + 1]; p < end;) {
+            uint64_t block = p / c.blockEdges, first = block * c.blockEdges;
+            uint64_t blockEnd = std::min(end, first + c.blockEdges);
+            BlockPin pin(c, block);
+            const int* targets = pin.frame().targets.data();
+            const int* it = std::lower_bound(targets + (p - first), targets + (blockEnd - first), to);
+            if (it != targets + (blockEnd - first)) return *it == to ? first + (it - targets) : -1;
+            p = blockEnd;
+        }
+        return -1;
+    }
+
+    // Обход всех дуг последовательным чтением блоков (рёбра симметричного представления — один раз): f(from, to, weight)
+    template<class F>
+    void forEachEdge(F f) const {
+        BlockCache& c = *cache;
+        int v = 0;
+        for (uint64_t block = 0, first = 0; first < c.edgeCount; ++block, first += c.blockEdges) {
+            c.schedule(block + 1);
+            c.schedule(block + 2);
+            BlockPin pin(c, block);
+            const BlockCache::Frame& frame = pin.frame();
+            for (size_t k = 0; k < frame.targets.size(); ++k) {
+                while (offsets[v + 1] <= first + k) ++v;
+                if (!symmetric || v <= frame.targets[k]) f(v, frame.targets[k], frame.weights[k]);
+            }
+        }
+    }
+
+    // Обход пучка дуг вершины: f(to, weight)
+    template<class F>
+    void forEachNeighbor(int vertex, F f) const {
+        if (vertex < 0 || vertex >= vertexSlots()) return;
+        BlockCache& c = *cache;
+        for (uint64_t p = offsets[vertex], end = offsets[vertex + 1]; p < end;) {
+            uint64_t block = p / c.blockEdges, first = block * c.blockEdges;
+            uint64_t blockEnd = std::min(end, first + c.blockEdges);
+            if (blockEnd < end) c.schedule(block + 1);
+            BlockPin pin(c, block);
+            const BlockCache::Frame& frame = pin.frame();
+            for (; p < blockEnd; ++p) f(frame.targets[p - first], frame.weights[p - first]);
+        }
+    }
+
+    // Фоновая загрузка первого блока пучка вершины
+    void prefetch(int vertex) const {
+        if (vertex < 0 || vertex >= vertexSlots() || offsets[vertex] == offsets[vertex + 1]) return;
+        cache->schedule(offsets[vertex] / cache->blockEdges);
+    }
+
+    // Поиск в ширину с предвыборкой пучков найденных вершин (-1 — не достигнута)
+    std::vector<int> bfs(int source) const {
+        std::vector<int> distance(vertexSlots(), -1);
+        if (source < 0 || source >= vertexSlots()) return distance;
+        std::queue<int> frontier;
+        distance[source] = 0;
+        frontier.push(source);
+        while (!frontier.empty()) {
+            int v = frontier.front();
+            frontier.pop();
+            forEachNeighbor(v, [&](int to, double) {
+                if (distance[to] != -1) return;
+                distance[to] = distance[v] + 1;
+                prefetch(to);
+                frontier.push(to);
+            });
+        }
+        return distance;
+    }
+
+    CacheStats cacheStats() const {
+        std::lock_guard<std::mutex> lock(cache->mutex);
+        return cache->stats;
+    }
+
+    void resetCacheStats() {
+        std::lock_guard<std::mutex> lock(cache->mutex);
+        cache->stats = CacheStats();
+    }
+
+private:
+    // Кэш блоков: кадры фиксированного числа, вытеснение CLOCK; закреплённые и загружаемые кадры не вытесняются
+    struct BlockCache {
+        struct Frame {
+            uint64_t block = 0;
+            bool used = false; // Кадр содержит блок (или загружает его)
+            bool loading = false;
+            bool referenced = false; // Бит обращения CLOCK
+            int pins = 0;
+            std::vector<int> targets;
+            std::vector<double> weights;
+        };
+
+        std::FILE* file = nullptr;
+        uint64_t edgeCount = 0, blockEdges = 0, dataOffset = 0;
+        std::vector<Frame> frames;
+        std::unordered_map<uint64_t, size_t> frameOf;
+        size_t hand = 0;
+        CacheStats stats;
+        std::mutex mutex, ioMutex;
+        std::condition_variable changed; // Загрузка завершена или кадр откреплён
+        std::condition_variable queued; // Появились блоки для предвыборки
+        std::queue<uint64_t> prefetchQueue;
+        bool stopping = false;
+        std::thread prefetcher;
 
+        explicit BlockCache(size_t cacheBlocks) : frames(cacheBlocks) {}
+
+        ~BlockCache() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            queued.notify_all();
+            if (prefetcher.joinable()) prefetcher.join();
+            if (file) std::fclose(file);
+        }
+
+        // Постановка блока в очередь предвыборки; при переполненной очереди запрос отбрасывается,
+        // чтобы предвыборка не вытесняла рабочий набор
+        void schedule(uint64_t block) {
+            if (block * blockEdges >= edgeCount) return;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (frameOf.count(block) || prefetchQueue.size() >= frames.size() / 4) return;
+                prefetchQueue.push(block);
+            }
+            queued.notify_one();
+        }
+
+        void prefetchLoop() {
+            std::unique_lock<std::mutex> lock(mutex);
+            while (true) {
+                queued.wait(lock, [&] { return stopping || !prefetchQueue.empty(); });
+                if (stopping) return;
+                uint64_t block = prefetchQueue.front();
+                prefetchQueue.pop();
+                if (frameOf.count(block) == 0) load(lock, block, true);
+            }
+        }
+
+        // Закрепление блока; при промахе блок читается в вытесненный кадр
+        size_t pin(uint64_t block) {
+            std::unique_lock<std::mutex> lock(mutex);
+            bool counted = false;
+            while (true) {
+                auto it = frameOf.find(block);
+                if (it == frameOf.end()) {
+                    size_t slot = load(lock, block, false);
+                    if (slot != SIZE_MAX) return slot;
+                    changed.wait(lock); // Все кадры закреплены
+                    continue;
+                }
+                Frame& frame = frames[it->second];
+                if (!counted) ++stats.hits;
+                counted = true;
+                if (frame.loading) {
+                    changed.wait(lock);
+                    continue;
+                }
+                ++frame.pins;
+                frame.referenced = true;
+                return it->second;
+            }
+        }
+
+        void unpin(size_t slot) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--frames[slot].pins == 0) changed.notify_all();
+        }
+
+        // Обход стрелки CLOCK: незакреплённый кадр без бита обращения (SIZE_MAX — все заняты)
+        size_t victim() {
+            for (size_t step = 0; step < 2 * frames.size(); ++step) {
+                Frame& frame = frames[hand];
+                size_t slot = hand;
+                hand = (hand + 1) % frames.size();
+                if (frame.pins > 0 || frame.loading) continue;
+                if (!frame.used || !frame.referenced) return slot;
+                frame.referenced = false;
+            }
+            return SIZE_MAX;
+        }
+
+        // Чтение блока в кадр; мьютекс кэша на время чтения отпускается.
+        // Загрузка по требованию возвращает закреплённый кадр
+        size_t load(std::unique_lock<std::mutex>& lock, uint64_t block, bool prefetch) {
+            size_t slot = victim();
+            if (slot == SIZE_MAX) return SIZE_MAX;
+            Frame& frame = frames[slot];
+            if (frame.used) {
+                frameOf.erase(frame.block);
+                ++stats.evictions;
+            }
+            frame.block = block;
+            frame.used = frame.loading = frame.referenced = true;
+            frameOf[block] = slot;
+            ++(prefetch ? stats.prefetched : stats.misses);
+            lock.unlock();
+            bool ok = read(block, frame);
+            lock.lock();
+            frame.loading = false;
+            if (!ok) {
+                frameOf.erase(block);
+                frame.used = false;
+            } else if (!prefetch) {
+                ++frame.pins;
+            }
+            changed.notify_all();
+            if (!ok && !prefetch) throw std::runtime_error("External graph block read failed");
+            return slot;
+        }
+
+        bool read(uint64_t block, Frame& frame) {
+            uint64_t first = block * blockEdges;
+            size_t count = std::min(blockEdges, edgeCount - first);
+            frame.targets.resize(count);
+            frame.weights.resize(count);
+            std::lock_guard<std::mutex> lock(ioMutex);
+            return std::fseek(file, dataOffset + first * 12, SEEK_SET) == 0 &&
+                   std::fread(frame.targets.data(), 4, count, file) == count &&
+                   std::fread(frame.weights.data(), 8, count, file) == count;
+        }
+    };
+
+    // Закрепление блока на время обхода
+    class BlockPin {
+    public:
+        BlockPin(BlockCache& cache, uint64_t block) : cache(cache), slot(cache.pin(block)) {}
+        ~BlockPin() { cache.unpin(slot); }
+        const BlockCache::Frame& frame() const { return cache.frames[slot]; }
+
+    private:
+        BlockCache& cache;
+        size_t slot;
+    };
+
+    std::unique_ptr<BlockCache> cache;
+
+    static uint64_t dataStart(uint64_t position) {
+        return (position + 4095) / 4096 * 4096;
+    }
+};
+
+// Неизменяемый (персистентный) граф: префиксное дерево по номерам вершин с разветвлением 32,
+// в листьях — пучки исходящих дуг. Копия графа — новая версия за O(1), изменение копирует
+// только путь от корня до изменённого пучка и сам пучок. Откат — присваивание сохранённой версии.
+// Разные версии можно читать и изменять из разных потоков, одну версию — из одного
+class PersistentGraph {
+public:
     // Вставка вершины
     void insertVertex(int vertex) {
-        vertices.insert(vertex);
+        if (!findBundle(vertex)) mutableBundle(vertex, true);
     }
 
     // Вставка дуги
     void insertEdge(int from, int to, double weight) {
-        I.push_back(from);
-        J.push_back(to);
-        weights.push_back(weight);
-        // Убедимся, что вершины также добавлены
-        insertVertex(from);
+        mutableBundle(from, true)->edges.emplace_back(to, weight);
+        ++edgeTotal;
         insertVertex(to);
     }
 
-    // Удаление вершины и всех её инцидентных рёбер
+    // Удаление всех дуг from -> to
+    void removeEdge(int from, int to) {
+        const Bundle* bundle = findBundle(from);
+        if (!bundle || std::none_of(bundle->edges.begin(), bundle->edges.end(),
+                                    [to](const auto& edge) { return edge.first == to; })) {
+            return;
+        }
+        std::vector<std::pair<int, double>>& edges = mutableBundle(from, false)->edges;
+        size_t before = edges.size();
+        edges.erase(std::remove_if(edges.begin(), edges.end(), [to](const auto& edge) { return edge.first == to; }),
+                    edges.end());
+        edgeTotal -= before - edges.size();
+    }
+
+    // Удаление вершины и всех инцидентных дуг; копируются только пучки, содержащие дуги в вершину
     void removeVertex(int vertex) {
-        // Удаляем рёбра, где вершина выступает как начальная или конечная
-        for (int k = I.size() - 1; k >= 0; --k) {
-            if (I[k] == vertex || J[k] == vertex) {
-                removeEdge(k);
+        std::vector<int> sources;
+        forEachBundle(root, levels, 0, [&](int from, const Bundle& bundle) {
+            for (const auto& edge : bundle.edges) {
+                if (edge.first == vertex && from != vertex) {
+                    sources.push_back(from);
+                    break;
+                }
+            }
+        });
+        for (int from : sources) removeEdge(from, vertex);
+        const Bundle* own = findBundle(vertex);
+        if (!own) return;
+        edgeTotal -= own->edges.size();
+        --vertexTotal;
+        *mutableSlot(vertex) = nullptr;
+    }
+
+    // Поиск вершины
+    bool findVertex(int vertex) const {
+        return findBundle(vertex) != nullptr;
+    }
+
+    // Поиск дуги
+    bool findEdge(int from, int to) const {
+        const Bundle* bundle = findBundle(from);
+        return bundle && std::any_of(bundle->edges.begin(), bundle->edges.end(),
+                                     [to](const auto& edge) { return edge.first == to; });
+    }
+
+    size_t vertexCount() const {
+        return vertexTotal;
+    }
+
+    size_t edgeCount() const {
+        return edgeTotal;
+    }
+
+    // Обход вершин по возрастанию номера: f(vertex)
+    template<class F>
+    void forEachVertex(F f) const {
+        forEachBundle(root, levels, 0, [&](int vertex, const Bundle&) { f(vertex); });
+    }
+
+    // Обход всех дуг: f(from, to, weight)
+    template<class F>
+    void forEachEdge(F f) const {
+        forEachBundle(root, levels, 0, [&](int from, const Bundle& bundle) {
+            for (const auto& [to, weight] : bundle.edges) f(from, to, weight);
+        });
+    }
+
+    // Обход пучка дуг вершины: f(to, weight)
+    template<class F>
+    void forEachNeighbor(int vertex, F f) const {
+        const Bundle* bundle = findBundle(vertex);
+        if (!bundle) return;
+        for (const auto& [to, weight] : bundle->edges) f(to, weight);
+    }
+
+    // Число узлов дерева и пучков, общих у двух версий (мера разделяемой памяти)
+    static size_t sharedNodes(const PersistentGraph& a, const PersistentGraph& b) {
+        return countShared(a.root, b.root, levels);
+    }
+
+    // Печать всех дуг
+    void printEdges() const {
+        forEachEdge([](int from, int to, double weight) {
+            std::cout << "Edge: " << from << " -> " << to << ", Weight: " << weight << "\n";
+        });
+    }
+
+private:
+    static constexpr int bits = 5;
+    static constexpr int fanout = 1 << bits;
+    static constexpr int levels = 7; // 7 * 5 бит покрывают 32-битный ключ
+
+    struct Bundle {
+        std::vector<std::pair<int, double>> edges;
+    };
+
+    // Узел дерева; на нижнем уровне слоты указывают на Bundle, выше — на Node
+    struct Node {
+        std::array<std::shared_ptr<void>, fanout> slots;
+    };
+
+    std::shared_ptr<void> root;
+    size_t vertexTotal = 0, edgeTotal = 0;
+
+    // Ключ, сохраняющий порядок знаковых номеров
+    static uint32_t keyOf(int vertex) {
+        return static_cast<uint32_t>(vertex) ^ 0x80000000u;
+    }
+
+    static int digit(uint32_t key, int level) {
+        return (key >> (bits * level)) & (fanout - 1);
+    }
+
+    const Bundle* findBundle(int vertex) const {
+        uint32_t key = keyOf(vertex);
+        const Node* node = static_cast<const Node*>(root.get());
+        for (int level = levels - 1; node && level > 0; --level) {
+            node = static_cast<const Node*>(node->slots[digit(key, level)].get());
+        }
+        return node ? static_cast<const Bundle*>(node->slots[digit(key, 0)].get()) : nullptr;
+    }
+
+    // Слот пучка вершины с копированием разделяемых узлов пути (узел с одним владельцем изменяется на месте)
+    std::shared_ptr<void>* mutableSlot(int vertex) {
+        uint32_t key = keyOf(vertex);
+        std::shared_ptr<void>* slot = &root;
+        for (int level = levels - 1; level >= 0; --level) {
+            if (!*slot) {
+                *slot = std::make_shared<Node>();
+            } else if (slot->use_count() > 1) {
+                *slot = std::make_shared<Node>(*static_cast<const Node*>(slot->get()));
             }
+            slot = &static_cast<Node*>(slot->get())->slots[digit(key, level)];
         }
-        // Удаляем вершину
-        vertices.erase(vertex);
+        return slot;
     }
 
-    // Удаление дуги по индексу
-    void removeEdge(int index) {
-        if (index >= 0 && index < I.size()) {
-            I.erase(I.begin() + index);
-            J.erase(J.begin() + index);
-            weights.erase(weights.begin() + index);
+    // Изменяемый пучок вершины: разделяемый пучок копируется, отсутствующий создаётся при create
+    Bundle* mutableBundle(int vertex, bool create) {
+        std::shared_ptr<void>* slot = mutableSlot(vertex);
+        if (!*slot) {
+            if (!create) return nullptr;
+            *slot = std::make_shared<Bundle>();
+            ++vertexTotal;
+        } else if (slot->use_count() > 1) {
+            *slot = std::make_shared<Bundle>(*static_cast<const Bundle*>(slot->get()));
         }
+        return static_cast<Bundle*>(slot->get());
     }
 
-    // Удаление дуги по вершинам (удаляет все дуги с данными вершинами)
-    void removeEdge(int from, int to) {
-        for (int k = I.size() - 1; k >= 0; --k) {
-            if (I[k] == from && J[k] == to) {
-                removeEdge(k);
+    // Обход пучков поддерева по возрастанию ключа: f(vertex, bundle)
+    template<class F>
+    static void forEachBundle(const std::shared_ptr<void>& slot, int level, uint32_t prefix, F&& f) {
+        if (!slot) return;
+        if (level == 0) {
+            f(static_cast<int>(prefix ^ 0x80000000u), *static_cast<const Bundle*>(slot.get()));
+            return;
+        }
+        const Node& node = *static_cast<const Node*>(slot.get());
+        for (int k = 0; k < fanout; ++k) {
+            forEachBundle(node.slots[k], level - 1, prefix | static_cast<uint32_t>(k) << (bits * (level - 1)), f);
+        }
+    }
+
+    static size_t countShared(const std::shared_ptr<void>& a, const std::shared_ptr<void>& b, int level) {
+        if (!a || !b) return 0;
+        if (a == b) return countNodes(a, level);
+        if (level == 0) return 0;
+        const Node& x = *static_cast<const Node*>(a.get());
+        const Node& y = *static_cast<const Node*>(b.get());
+        size_t shared = 0;
+        for (int k = 0; k < fanout; ++k) shared += countShared(x.slots[k], y.slots[k], level - 1);
+        return shared;
+    }
+
+    static size_t countNodes(const std::shared_ptr<void>& slot, int level) {
+        if (!slot) return 0;
+        if (level == 0) return 1;
+        size_t count = 1;
+        for (const auto& child : static_cast<const Node*>(slot.get())->slots) count += countNodes(child, level - 1);
+        return count;
+    }
+};
+
+// Программная предвыборка строки кэша для чтения
+template<class T>
+inline void prefetchLine(const T* address) {
+#if defined(__GNUC__)
+    __builtin_prefetch(address, 0, 3);
+#endif
+}
+
+// Чередующееся выполнение независимых задач (AMAC). Задача — конечный автомат: шаг использует
+// данные, предвыбранные прошлым шагом, выдаёт предвыборку следующего адреса и уступает очередь.
+// Пока width задач по кругу делают по шагу, промахи кэша разных задач перекрываются.
+// Machine::State — состояние задачи; start(state, task) и step(state) возвращают true, когда задача завершена
+template<class Machine>
+void runInterleaved(Machine& machine, size_t tasks, unsigned width = 16) {
+    std::vector<typename Machine::State> lanes(std::max(1u, width));
+    std::vector<char> busy(lanes.size(), 0);
+    size_t next = 0, active = 0;
+    auto refill = [&](size_t lane) {
+        while (next < tasks) {
+            if (!machine.start(lanes[lane], next++)) {
+                busy[lane] = 1;
+                ++active;
+                return;
+            }
+        }
+    };
+    for (size_t lane = 0; lane < lanes.size(); ++lane) refill(lane);
+    while (active > 0) {
+        for (size_t lane = 0; lane < lanes.size(); ++lane) {
+            if (busy[lane] && machine.step(lanes[lane])) {
+                busy[lane] = 0;
+                --active;
+                refill(lane);
             }
         }
     }
+}
 
-    // Поиск вершины
-    bool findVertex(int vertex) {
-        return vertices.find(vertex) != vertices.end();
+// Поиск дуги в BundledEdgeListGraph: шаг — одно звено цепочки H/L
+struct BundledFindEdgeMachine {
+    struct State {
+        size_t task;
+        int edge; // Дуга, данные которой предвыбраны; -2 — предвыбрана голова H[from]
+    };
+
+    const BundledEdgeListGraph& g;
+    const std::vector<std::pair<int, int>>& queries;
+    std::vector<int>& results;
+
+    bool start(State& s, size_t task) {
+        auto [from, to] = queries[task];
+        results[task] = -1;
+        if (from < 0 || from >= static_cast<int>(g.H.size())) return true;
+        if (g.edgeFilter && !g.edgeFilter->mayContain(from, to)) return true;
+        s.task = task;
+        s.edge = -2;
+        prefetchLine(&g.H[from]);
+        return false;
     }
 
-    // Поиск дуги (возвращает индекс или -1)
-    int findEdge(int from, int to) {
-        for (size_t k = 0; k < I.size(); ++k) {
-            if (I[k] == from && J[k] == to) {
-                return k;
+    bool step(State& s) {
+        auto [from, to] = queries[s.task];
+        if (s.edge == -2) {
+            s.edge = g.H[from];
+        } else {
+            GRAPH_COUNT(ChainSteps, 1);
+            if (g.J[s.edge] == to) {
+                results[s.task] = s.edge;
+                return true;
             }
+            s.edge = g.L[s.edge];
         }
-        return -1;
+        if (s.edge == -1) return true;
+        prefetchLine(&g.J[s.edge]);
+        prefetchLine(&g.L[s.edge]);
+        return false;
     }
+};
 
-    // Печать всех рёбер
-    void printEdges() {
-        for (size_t k = 0; k < I.size(); ++k) {
-            std::cout << "Edge " << k << ": " << I[k] << " -> " << J[k]
-                      << ", Weight: " << weights[k] << "\n";
+// Пакетный поиск дуг (индексы или -1) с чередованием width запросов
+inline std::vector<int> batchFindEdges(const BundledEdgeListGraph& g, const std::vector<std::pair<int, int>>& queries,
+                                       unsigned width = 16) {
+    std::vector<int> results(queries.size());
+    BundledFindEdgeMachine machine{g, queries, results};
+    runInterleaved(machine, queries.size(), width);
+    return results;
+}
+
+// Операции над графом: изменения записываются в журнал, чтения — только в трассу операций
+enum class GraphOp : uint8_t { InsertVertex, InsertEdge, RemoveEdge, RemoveVertex, FindVertex, FindEdge, ForEachNeighbor };
+
+// Запись журнала изменений
+struct MutationRecord {
+    GraphOp op;
+    int from;
+    int to;
+    double weight;
+};
+
+// Двоичный вид записи: op (1 байт), from, to (по 4), weight (8), контрольная сумма (4)
+const size_t mutationRecordSize = 21;
+
+// Контрольная сумма FNV-1a
+inline uint32_t checksum(const char* data, size_t size) {
+    uint32_t hash = 2166136261u;
+    for (size_t k = 0; k < size; ++k) {
+        hash = (hash ^ static_cast<unsigned char>(data[k])) * 16777619u;
+    }
+    return hash;
+}
+
+void encodeRecord(const MutationRecord& record, char* out) {
+    out[0] = static_cast<char>(record.op);
+    std::memcpy(out + 1, &record.from, 4);
+    std::memcpy(out + 5, &record.to, 4);
+    std::memcpy(out + 9, &record.weight, 8);
+    uint32_t sum = checksum(out, 17);
+    std::memcpy(out + 17, &sum, 4);
+}
+
+// Разбор записи; false, если запись повреждена
+bool decodeRecord(const char* in, MutationRecord& record) {
+    uint32_t sum;
+    std::memcpy(&sum, in + 17, 4);
+    if (sum != checksum(in, 17) || static_cast<uint8_t>(in[0]) > static_cast<uint8_t>(GraphOp::RemoveVertex)) {
+        return false;
+    }
+    record.op = static_cast<GraphOp>(in[0]);
+    std::memcpy(&record.from, in + 1, 4);
+    std::memcpy(&record.to, in + 5, 4);
+    std::memcpy(&record.weight, in + 9, 8);
+    return true;
+}
+
+// Применение записи к графу
+template<class Graph>
+void applyRecord(Graph& graph, const MutationRecord& record) {
+    switch (record.op) {
+        case GraphOp::InsertVertex: graph.insertVertex(record.from); break;
+        case GraphOp::InsertEdge: graph.insertEdge(record.from, record.to, record.weight); break;
+        case GraphOp::RemoveEdge: graph.removeEdge(record.from, record.to); break;
+        case GraphOp::RemoveVertex: graph.removeVertex(record.from); break;
+        default: break; // Чтения граф не изменяют
+    }
+}
+
+// Сброс буферов файла на диск
+inline void syncFile(std::FILE* file) {
+    std::fflush(file);
+#ifdef __unix__
+    fsync(fileno(file));
+#endif
+}
+
+// Сброс записи каталога на диск: без него переименование файла может не пережить сбой
+inline void syncDirectory(const std::string& directory) {
+#ifdef __unix__
+    int handle = open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+    if (handle >= 0) {
+        fsync(handle);
+        close(handle);
+    }
+#endif
+}
+
+// Граф хранит дуги в массивах I/J/weights, которые можно писать напрямую
+template<class Graph, class = void>
+struct HasEdgeArrays : std::false_type {};
+
+template<class Graph>
+struct HasEdgeArrays<Graph, std::void_t<decltype(std::declval<Graph>().I), decltype(std::declval<Graph>().J),
+                                        decltype(std::declval<Graph>().weights)>> : std::true_type {};
+
+// Двоичный снимок графа: сигнатура, вершины, затем дуги (from, to, weight).
+// Массивы дуг списков пишутся как есть, дуги остальных графов сначала собираются через forEachEdge
+template<class Graph>
+bool writeSnapshot(std::FILE* file, const Graph& graph) {
+    auto write = [&](const void* data, size_t size, size_t count) {
+        return count == 0 || std::fwrite(data, size, count, file) == count;
+    };
+    const char magic[4] = {'K', 'I', 'T', 'G'};
+    uint64_t vertexCount = graph.vertices.size();
+    std::vector<int> vertexList(graph.vertices.begin(), graph.vertices.end());
+    bool ok = write(magic, 1, 4) && write(&vertexCount, 8, 1) && write(vertexList.data(), 4, vertexList.size());
+
+    std::vector<int> gatheredI, gatheredJ;
+    std::vector<double> gatheredWeights;
+    const int* I;
+    const int* J;
+    const double* weights;
+    uint64_t edgeCount;
+    if constexpr (HasEdgeArrays<Graph>::value) {
+        I = graph.I.data();
+        J = graph.J.data();
+        weights = graph.weights.data();
+        edgeCount = graph.I.size();
+    } else {
+        graph.forEachEdge([&](int from, int to, double weight) {
+            gatheredI.push_back(from);
+            gatheredJ.push_back(to);
+            gatheredWeights.push_back(weight);
+        });
+        I = gatheredI.data();
+        J = gatheredJ.data();
+        weights = gatheredWeights.data();
+        edgeCount = gatheredI.size();
+    }
+    return ok && write(&edgeCount, 8, 1) && write(I, 4, edgeCount) && write(J, 4, edgeCount) &&
+           write(weights, 8, edgeCount);
+}
+
+template<class Graph>
+bool readSnapshot(std::FILE* file, Graph& graph) {
+    char magic[4];
+    uint64_t vertexCount, edgeCount;
+    if (std::fread(magic, 1, 4, file) != 4 || std::memcmp(magic, "KITG", 4) != 0 ||
+        std::fread(&vertexCount, 8, 1, file) != 1) {
+        return false;
+    }
+    for (uint64_t k = 0; k < vertexCount; ++k) {
+        int v;
+        if (std::fread(&v, 4, 1, file) != 1) return false;
+        graph.insertVertex(v);
+    }
+    if (std::fread(&edgeCount, 8, 1, file) != 1) return false;
+    std::vector<int> I(edgeCount), J(edgeCount);
+    std::vector<double> weights(edgeCount);
+    if (std::fread(I.data(), 4, edgeCount, file) != edgeCount || std::fread(J.data(), 4, edgeCount, file) != edgeCount ||
+        std::fread(weights.data(), 8, edgeCount, file) != edgeCount) {
+        return false;
+    }
+    graph.insertEdges(I, J, weights);
+    return true;
+}
+
+// Форматы выгрузки графа
+enum class ExportFormat {
+    EdgeList, // Строки "from to weight"
+    Csv, // Заголовок "from,to,weight" и строки значений
+    Dot, // Описание Graphviz
+    Binary // Двоичный снимок в формате writeSnapshot
+};
+
+// Наибольшая длина строки одной дуги: два int по 11 знаков, double до 24 знаков и разметка DOT
+constexpr size_t maxExportLine = 80;
+
+// Форматирование одной дуги без промежуточных строк; возвращает конец записанного
+inline char* formatExportEdge(char* out, ExportFormat format, bool undirected, int from, int to, double weight) {
+    char separator = format == ExportFormat::Csv ? ',' : ' ';
+    if (format == ExportFormat::Dot) {
+        std::memcpy(out, "  ", 2);
+        out += 2;
+    }
+    out = std::to_chars(out, out + 11, from).ptr;
+    if (format == ExportFormat::Dot) {
+        std::memcpy(out, undirected ? " -- " : " -> ", 4);
+        out += 4;
+    } else {
+        *out++ = separator;
+    }
+    out = std::to_chars(out, out + 11, to).ptr;
+    if (format == ExportFormat::Dot) {
+        std::memcpy(out, " [weight=", 9);
+        out += 9;
+    } else {
+        *out++ = separator;
+    }
+    out = std::to_chars(out, out + 24, weight).ptr;
+    if (format == ExportFormat::Dot) {
+        std::memcpy(out, "];", 2);
+        out += 2;
+    }
+    *out++ = '\n';
+    return out;
+}
+
+// Выгрузка графа в открытый файл. Дуги обрабатываются раундами: в раунде каждый поток форматирует
+// свой отрезок дуг в собственный переиспользуемый буфер, затем буферы дописываются по порядку,
+// пока следующий раунд форматируется
+template<class Graph>
+bool exportGraph(const Graph& g, std::FILE* file, ExportFormat format, unsigned threads = hardwareThreads()) {
+    if (format == ExportFormat::Binary) return writeSnapshot(file, g);
+
+    std::vector<int> gatheredI, gatheredJ;
+    std::vector<double> gatheredWeights;
+    const int* I;
+    const int* J;
+    const double* weights;
+    size_t edgeCount;
+    if constexpr (HasEdgeArrays<Graph>::value) {
+        I = g.I.data();
+        J = g.J.data();
+        weights = g.weights.data();
+        edgeCount = g.I.size();
+    } else {
+        g.forEachEdge([&](int from, int to, double weight) {
+            gatheredI.push_back(from);
+            gatheredJ.push_back(to);
+            gatheredWeights.push_back(weight);
+        });
+        I = gatheredI.data();
+        J = gatheredJ.data();
+        weights = gatheredWeights.data();
+        edgeCount = gatheredI.size();
+    }
+    bool undirected = isUndirectedGraph(g);
+
+    std::vector<char> header;
+    auto append = [&](const char* text) { header.insert(header.end(), text, text + std::strlen(text)); };
+    if (format == ExportFormat::Csv) append("from,to,weight\n");
+    if (format == ExportFormat::Dot) {
+        append(undirected ? "graph G {\n" : "digraph G {\n");
+        // Вершины перечисляются явно, чтобы сохранить изолированные
+        for (int v : g.vertices) {
+            char line[16];
+            char* end = std::to_chars(line, line + 11, v).ptr;
+            header.push_back(' ');
+            header.push_back(' ');
+            header.insert(header.end(), line, end);
+            append(";\n");
         }
     }
+    bool ok = header.empty() || std::fwrite(header.data(), 1, header.size(), file) == header.size();
 
-    // Печать всех вершин
-    void printVertices() {
-        std::cout << "Vertices: ";
-        for (const int &v : vertices) {
-            std::cout << v << " ";
+    // Две группы буферов: одна форматируется, другая пишется
+    const size_t chunkEdges = 1 << 16;
+    threads = std::max(1u, threads);
+    size_t roundEdges = chunkEdges * threads;
+    std::vector<std::vector<char>> buffers[2];
+    std::vector<size_t> sizes[2];
+    for (int b = 0; b < 2; ++b) {
+        buffers[b].resize(threads);
+        sizes[b].assign(threads, 0);
+    }
+    std::future<bool> writing;
+    int current = 0;
+    for (size_t first = 0; first < edgeCount; first += roundEdges) {
+        size_t count = std::min(roundEdges, edgeCount - first);
+        std::fill(sizes[current].begin(), sizes[current].end(), 0);
+        parallelFor(count, threads, [&](size_t begin, size_t end, unsigned part) {
+            std::vector<char>& buffer = buffers[current][part];
+            if (buffer.size() < (end - begin) * maxExportLine) buffer.resize((end - begin) * maxExportLine);
+            char* out = buffer.data();
+            for (size_t k = first + begin; k < first + end; ++k) {
+                out = formatExportEdge(out, format, undirected, I[k], J[k], weights[k]);
+            }
+            sizes[current][part] = out - buffer.data();
+        });
+        if (writing.valid()) ok = writing.get() && ok;
+        writing = std::async(std::launch::async, [&, current] {
+            bool written = true;
+            for (unsigned part = 0; part < threads; ++part) {
+                size_t size = sizes[current][part];
+                written = written && (size == 0 || std::fwrite(buffers[current][part].data(), 1, size, file) == size);
+            }
+            return written;
+        });
+        current ^= 1;
+    }
+    if (writing.valid()) ok = writing.get() && ok;
+    if (format == ExportFormat::Dot) ok = ok && std::fputs("}\n", file) >= 0;
+    return ok;
+}
+
+// Выгрузка графа в файл по пути
+template<class Graph>
+bool exportGraph(const Graph& g, const std::string& path, ExportFormat format, unsigned threads = hardwareThreads()) {
+    std::FILE* file = std::fopen(path.c_str(), format == ExportFormat::Binary ? "wb" : "w");
+    if (!file) return false;
+    // Запись идёт крупными блоками, собственный буфер потока не нужен
+    std::setvbuf(file, nullptr, _IONBF, 0);
+    bool ok = exportGraph(g, file, format, threads);
+    return std::fclose(file) == 0 && ok;
+}
+
+// Асинхронное чтение блоков файла в буферы: submit ставит чтение в очередь, wait возвращает
+// завершённое чтение (слот, число байт или -errno)
+class ChunkReader {
+public:
+    virtual ~ChunkReader() = default;
+    virtual void submit(size_t slot, char* buffer, uint64_t offset, size_t length) = 0;
+    virtual std::pair<size_t, long long> wait() = 0;
+};
+
+#ifdef GRAPH_IO_URING
+// Чтение через io_uring без liburing: кольца отображаются в память, запросы IORING_OP_READV
+class UringChunkReader : public ChunkReader {
+public:
+    UringChunkReader(int file, unsigned depth) : file(file), vectors(depth) {
+        io_uring_params params{};
+        ring = syscall(__NR_io_uring_setup, depth, &params);
+        if (ring < 0) throw std::runtime_error("io_uring_setup failed");
+        sqSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cqSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+        sq = mmap(nullptr, sqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring, IORING_OFF_SQ_RING);
+        cq = mmap(nullptr, cqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring, IORING_OFF_CQ_RING);
+        sqes = static_cast<io_uring_sqe*>(mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                                ring, IORING_OFF_SQES));
+        if (sq == MAP_FAILED || cq == MAP_FAILED || sqes == MAP_FAILED) {
+            release();
+            throw std::runtime_error("io_uring mmap failed");
         }
-        std::cout << "\n";
+        char* s = static_cast<char*>(sq);
+        sqTail = reinterpret_cast<unsigned*>(s + params.sq_off.tail);
+        sqMask = *reinterpret_cast<unsigned*>(s + params.sq_off.ring_mask);
+        sqArray = reinterpret_cast<unsigned*>(s + params.sq_off.array);
+        char* c = static_cast<char*>(cq);
+        cqHead = reinterpret_cast<unsigned*>(c + params.cq_off.head);
+        cqTail = reinterpret_cast<unsigned*>(c + params.cq_off.tail);
+        cqMask = *reinterpret_cast<unsigned*>(c + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe*>(c + params.cq_off.cqes);
+    }
+
+    ~UringChunkReader() override {
+        release();
+    }
+
+    void submit(size_t slot, char* buffer, uint64_t offset, size_t length) override {
+        vectors[slot] = {buffer, length};
+        unsigned tail = *sqTail, index = tail & sqMask;
+        io_uring_sqe& sqe = sqes[index];
+        std::memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = IORING_OP_READV;
+        sqe.fd = file;
+        sqe.off = offset;
+        sqe.addr = reinterpret_cast<uint64_t>(&vectors[slot]);
+        sqe.len = 1;
+        sqe.user_data = slot;
+        sqArray[index] = index;
+        __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+        if (syscall(__NR_io_uring_enter, ring, 1, 0, 0, nullptr, 0) < 0) {
+            throw std::runtime_error("io_uring_enter failed");
+        }
+    }
+
+    std::pair<size_t, long long> wait() override {
+        unsigned head = *cqHead;
+        while (head == __atomic_load_n(cqTail, __ATOMIC_ACQUIRE)) {
+            if (syscall(__NR_io_uring_enter, ring, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0) < 0 && errno != EINTR) {
+                throw std::runtime_error("io_uring_enter failed");
+            }
+        }
+        const io_uring_cqe& cqe = cqes[head & cqMask];
+        std::pair<size_t, long long> done(cqe.user_data, cqe.res);
+        __atomic_store_n(cqHead, head + 1, __ATOMIC_RELEASE);
+        return done;
+    }
+
+private:
+    int file;
+    int ring = -1;
+    std::vector<iovec> vectors; // Описания буферов по слотам; живут до завершения чтения
+    void* sq = MAP_FAILED;
+    void* cq = MAP_FAILED;
+    io_uring_sqe* sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+    size_t sqSize = 0, cqSize = 0, sqesSize = 0;
+    unsigned* sqTail = nullptr;
+    unsigned* sqArray = nullptr;
+    unsigned sqMask = 0;
+    unsigned* cqHead = nullptr;
+    unsigned* cqTail = nullptr;
+    unsigned cqMask = 0;
+    io_uring_cqe* cqes = nullptr;
+
+    void release() {
+        if (sqes != MAP_FAILED) munmap(sqes, sqesSize);
+        if (cq != MAP_FAILED) munmap(cq, cqSize);
+        if (sq != MAP_FAILED) munmap(sq, sqSize);
+        if (ring >= 0) close(ring);
     }
 };
+#endif
 
-// Список пучков дуг
-class BundledEdgeListGraph {
+#ifdef __unix__
+// Запасной путь: пул потоков, выполняющих pread
+class PreadChunkReader : public ChunkReader {
 public:
-    std::vector<int> I; // Начальные вершины дуг
-    std::vector<int> J; // Конечные вершины дуг
-    std::vector<double> weights; // Вес дуг
-    std::vector<int> H; // Массив голов списков пучков дуг
-    std::vector<int> L; // Массив ссылок на следующую дугу
-    std::unordered_set<int> vertices; // Уникальные вершины
+    PreadChunkReader(int file, unsigned threads) : file(file) {
+        for (unsigned t = 0; t < threads; ++t) workers.emplace_back([this] { work(); });
+    }
 
-    // Конструктор для инициализации массивов
-    BundledEdgeListGraph(int numVertices) {
-        H.resize(numVertices, -1);
+    ~PreadChunkReader() override {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        requested.notify_all();
+        for (auto& worker : workers) worker.join();
     }
 
-    // Вставка вершины
-    void insertVertex(int vertex) {
-        vertices.insert(vertex);
-        if (vertex >= H.size()) {
-            H.resize(vertex + 1, -1); // Расширение массива голов при необходимости
+    void submit(size_t slot, char* buffer, uint64_t offset, size_t length) override {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            requests.push({slot, buffer, offset, length});
         }
+        requested.notify_one();
     }
 
-    // Вставка дуги
-    void insertEdge(int from, int to, double weight) {
-        int edgeIndex = I.size();
-        I.push_back(from);
-        J.push_back(to);
-        weights.push_back(weight);
+    std::pair<size_t, long long> wait() override {
+        std::unique_lock<std::mutex> lock(mutex);
+        completed.wait(lock, [&] { return !results.empty(); });
+        auto done = results.front();
+        results.pop();
+        return done;
+    }
 
-        // Добавляем ссылку на предыдущую дугу
-        L.push_back(H[from]);
-        H[from] = edgeIndex;
+private:
+    struct Request {
+        size_t slot;
+        char* buffer;
+        uint64_t offset;
+        size_t length;
+    };
 
-        // Добавляем вершины в набор, если их ещё нет
-        insertVertex(from);
-        insertVertex(to);
+    int file;
+    std::mutex mutex;
+    std::condition_variable requested, completed;
+    std::queue<Request> requests;
+    std::queue<std::pair<size_t, long long>> results;
+    bool stopping = false;
+    std::vector<std::thread> workers;
+
+    void work() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            requested.wait(lock, [&] { return stopping || !requests.empty(); });
+            if (stopping) return;
+            Request request = requests.front();
+            requests.pop();
+            lock.unlock();
+            ssize_t bytes = pread(file, request.buffer, request.length, request.offset);
+            long long result = bytes < 0 ? -static_cast<long long>(errno) : bytes;
+            lock.lock();
+            results.push({request.slot, result});
+            completed.notify_one();
+        }
     }
+};
 
-    // Удаление дуги по индексу
-    void removeEdge(int index) {
-        if (index >= 0 && index < I.size()) {
-            int from = I[index];
+// Итоги загрузки файла
+struct LoadStats {
+    uint64_t bytes = 0;
+    size_t edges = 0;
+    bool ioUring = false; // Чтение шло через io_uring (иначе пул pread)
+    double seconds = 0;
+};
 
-            // Удаление дуги из списка пучков
-            if (H[from] == index) {
-                H[from] = L[index];
-            } else {
-                for (int i = H[from]; i != -1; i = L[i]) {
-                    if (L[i] == index) {
-                        L[i] = L[index];
-                        break;
-                    }
+// Разбор одной строки "from to [weight]" (разделители — пробелы, табуляции или запятые);
+// false для строк без дуги (пустых, комментариев '#' и заголовка)
+inline bool parseEdgeLine(const char* begin, const char* end, int& from, int& to, double& weight) {
+    auto skip = [&](const char* p) {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == ',' || *p == '\r')) ++p;
+        return p;
+    };
+    const char* p = skip(begin);
+    if (p == end || *p == '#') return false;
+    auto first = std::from_chars(p, end, from);
+    if (first.ec != std::errc()) return false;
+    auto second = std::from_chars(skip(first.ptr), end, to);
+    if (second.ec != std::errc()) return false;
+    p = skip(second.ptr);
+    weight = 1.0;
+    if (p < end) std::from_chars(p, end, weight);
+    return true;
+}
+
+// Конвейерная загрузка текстового списка дуг (ExportFormat::EdgeList или Csv) в граф.
+// Блоки файла читаются асинхронно (io_uring, иначе пул pread) в buffers буферов; пока читается
+// блок N + 1, блок N разбирается, а дуги блока N - 1 вставляет отдельный поток.
+// Очереди ограничены числом буферов и двумя пакетами разобранных дуг
+template<class Graph>
+LoadStats loadEdgeListFile(const std::string& path, Graph& graph, size_t chunkSize = size_t(4) << 20,
+                           unsigned buffers = 4, bool allowIoUring = true) {
+    if (chunkSize == 0 || buffers == 0) throw std::invalid_argument("loadEdgeListFile needs chunkSize and buffers > 0");
+    auto start = std::chrono::steady_clock::now();
+    int file = open(path.c_str(), O_RDONLY);
+    if (file < 0) throw std::runtime_error("Cannot open " + path);
+    struct stat info;
+    if (fstat(file, &info) != 0) {
+        close(file);
+        throw std::runtime_error("Cannot stat " + path);
+    }
+    uint64_t fileSize = info.st_size;
+    LoadStats stats;
+    stats.bytes = fileSize;
+
+    std::unique_ptr<ChunkReader> reader;
+#ifdef GRAPH_IO_URING
+    if (allowIoUring) {
+        try {
+            reader = std::make_unique<UringChunkReader>(file, buffers);
+            stats.ioUring = true;
+        } catch (const std::runtime_error&) {
+            // Ядро без io_uring или запрет seccomp: пул pread
+        }
+    }
+#endif
+    if (!reader) reader = std::make_unique<PreadChunkReader>(file, buffers);
+
+    // Вставка пакетов в отдельном потоке
+    struct Batch {
+        std::vector<int> from, to;
+        std::vector<double> weights;
+    };
+    std::mutex batchMutex;
+    std::condition_variable batchChanged;
+    std::queue<Batch> batches;
+    bool parsingDone = false;
+    std::exception_ptr insertError; // Исключение потока вставки; перебрасывается после join
+    std::thread inserter([&] {
+        std::unique_lock<std::mutex> lock(batchMutex);
+        try {
+            while (true) {
+                batchChanged.wait(lock, [&] { return parsingDone || !batches.empty(); });
+                if (batches.empty()) return;
+                Batch batch = std::move(batches.front());
+                batches.pop();
+                batchChanged.notify_all();
+                lock.unlock();
+                for (size_t k = 0; k < batch.from.size(); ++k) {
+                    graph.insertEdge(batch.from[k], batch.to[k], batch.weights[k]);
                 }
+                lock.lock();
             }
+        } catch (...) {
+            // Разбор останавливается, ожидая очередь, и увидит ошибку
+            if (!lock.owns_lock()) lock.lock();
+            insertError = std::current_exception();
+            batchChanged.notify_all();
+        }
+    });
 
-            // Удаление элементов из массивов
-            I.erase(I.begin() + index);
-            J.erase(J.begin() + index);
-            weights.erase(weights.begin() + index);
-            L.erase(L.begin() + index);
+    size_t chunkCount = (fileSize + chunkSize - 1) / chunkSize;
+    std::vector<std::vector<char>> slots(buffers, std::vector<char>(chunkSize));
+    std::vector<size_t> slotChunk(buffers), slotFilled(buffers, 0);
+    std::vector<bool> slotReady(buffers, false);
+    size_t nextToRead = 0, inFlight = 0;
+    auto chunkLength = [&](size_t chunk) { return std::min<uint64_t>(chunkSize, fileSize - chunk * chunkSize); };
+    auto issue = [&](size_t slot) {
+        slotChunk[slot] = nextToRead++;
+        slotFilled[slot] = 0;
+        slotReady[slot] = false;
+        reader->submit(slot, slots[slot].data(), slotChunk[slot] * chunkSize, chunkLength(slotChunk[slot]));
+        ++inFlight;
+    };
 
-            // Обновление ссылок после удаления элемента
-            for (int &link : L) {
-                if (link > index) {
-                    --link;
+    std::string carry; // Незавершённая строка с конца предыдущего блока
+    std::exception_ptr readError;
+    try {
+        for (size_t slot = 0; slot < buffers && nextToRead < chunkCount; ++slot) issue(slot);
+        for (size_t chunk = 0; chunk < chunkCount; ++chunk) {
+            size_t slot = chunk % buffers;
+            // Ожидание блока chunk; короткое чтение дочитывается тем же слотом
+            while (!slotReady[slot]) {
+                auto [done, result] = reader->wait();
+                --inFlight;
+                if (result <= 0) throw std::runtime_error("Read failed in " + path);
+                slotFilled[done] += result;
+                size_t length = chunkLength(slotChunk[done]);
+                if (slotFilled[done] < length) {
+                    reader->submit(done, slots[done].data() + slotFilled[done],
+                                   slotChunk[done] * chunkSize + slotFilled[done], length - slotFilled[done]);
+                    ++inFlight;
+                } else {
+                    slotReady[done] = true;
                 }
             }
-            for (int &head : H) {
-                if (head > index) {
-                    --head;
+
+            Batch batch;
+            int from, to;
+            double weight;
+            const char* p = slots[slot].data();
+            const char* end = p + chunkLength(chunk);
+            const char* newline = static_cast<const char*>(std::memchr(p, '\n', end - p));
+            if (!carry.empty() || chunk == 0) {
+                if (!newline) {
+                    carry.append(p, end);
+                    p = end;
+                } else {
+                    carry.append(p, newline);
+                    if (parseEdgeLine(carry.data(), carry.data() + carry.size(), from, to, weight)) {
+                        batch.from.push_back(from);
+                        batch.to.push_back(to);
+                        batch.weights.push_back(weight);
+                    }
+                    carry.clear();
+                    p = newline + 1;
+                }
+            }
+            while (p < end) {
+                newline = static_cast<const char*>(std::memchr(p, '\n', end - p));
+                if (!newline) {
+                    carry.assign(p, end);
+                    break;
+                }
+                if (parseEdgeLine(p, newline, from, to, weight)) {
+                    batch.from.push_back(from);
+                    batch.to.push_back(to);
+                    batch.weights.push_back(weight);
                 }
+                p = newline + 1;
             }
+            if (chunk + 1 == chunkCount &&
+                parseEdgeLine(carry.data(), carry.data() + carry.size(), from, to, weight)) {
+                batch.from.push_back(from);
+                batch.to.push_back(to);
+                batch.weights.push_back(weight);
+            }
+
+            // Буфер разобран: в него читается следующий блок
+            if (nextToRead < chunkCount) issue(slot);
+            stats.edges += batch.from.size();
+            std::unique_lock<std::mutex> lock(batchMutex);
+            batchChanged.wait(lock, [&] { return batches.size() < 2 || insertError; });
+            if (insertError) break;
+            batches.push(std::move(batch));
+            batchChanged.notify_all();
         }
+    } catch (...) {
+        // Поток вставки нужно дождаться, иначе деструктор std::thread вызовет terminate
+        readError = std::current_exception();
     }
+    {
+        std::lock_guard<std::mutex> lock(batchMutex);
+        parsingDone = true;
+    }
+    batchChanged.notify_all();
+    inserter.join();
+    // Незавершённые чтения должны закончиться до освобождения буферов
+    for (; inFlight > 0; --inFlight) reader->wait();
+    reader.reset();
+    close(file);
+    if (insertError) std::rethrow_exception(insertError);
+    if (readError) std::rethrow_exception(readError);
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return stats;
+}
+#endif
 
-    // Удаление дуги по инцидентным вершинам
-    void removeEdge(int from, int to) {
-        for (int i = H[from]; i != -1;) {
-            if (J[i] == to) {
-                int next = L[i];
-                removeEdge(i);
-                i = next;
-            } else {
-                i = L[i];
-            }
+// Граф с журналом упреждающей записи (WAL) и контрольными точками.
+// Журнал wal-<поколение>.log дописывается группами записей; контрольная точка checkpoint.bin
+// хранит поколение и полный снимок. Восстановление: снимок + хвост журнала его поколения
+template<class Graph = EdgeListGraph>
+class DurableGraph {
+public:
+    Graph graph; // Граф в памяти; изменять только через методы DurableGraph
+    size_t groupSize = 64; // Записей в одной группе фиксации
+    size_t checkpointInterval = 1 << 16; // Записей журнала между контрольными точками
+
+    // Открытие каталога с восстановлением состояния
+    explicit DurableGraph(const std::string& directory) : DurableGraph(directory, Graph()) {}
+
+    // То же для графа без конструктора по умолчанию: initial — пустой граф нужной формы
+    DurableGraph(const std::string& directory, Graph initial) : graph(std::move(initial)), directory(directory) {
+        std::filesystem::create_directories(directory);
+        if (std::FILE* file = std::fopen(checkpointPath().c_str(), "rb")) {
+            bool ok = std::fread(&generation, 8, 1, file) == 1 && readSnapshot(file, graph);
+            std::fclose(file);
+            if (!ok) throw std::runtime_error("Corrupted checkpoint in " + directory);
         }
+        replayLog();
+        wal = std::fopen(walPath(generation).c_str(), "ab");
+        if (!wal) throw std::runtime_error("Cannot open write-ahead log in " + directory);
     }
 
-    // Удаление вершины и всех её инцидентных рёбер
-    void removeVertex(int vertex) {
-        if (!findVertex(vertex)) return;
+    DurableGraph(const DurableGraph&) = delete;
+    DurableGraph& operator=(const DurableGraph&) = delete;
 
-        for (int i = H[vertex]; i != -1;) {
-            int next = L[i];
-            removeEdge(i);
-            i = next;
+    ~DurableGraph() {
+        try {
+            commit();
+        } catch (const std::runtime_error& e) {
+            // Деструктор не бросает: незафиксированная группа теряется, как при сбое
+            std::cerr << "DurableGraph: " << e.what() << "\n";
         }
+        std::fclose(wal);
+    }
 
-        vertices.erase(vertex);
-        H[vertex] = -1; // Обнуление головы списка для удалённой вершины
+    // Вставка вершины
+    void insertVertex(int vertex) {
+        log({GraphOp::InsertVertex, vertex, 0, 0.0});
     }
 
-    // Поиск вершины
-    bool findVertex(int vertex) {
-        return vertices.find(vertex) != vertices.end();
+    // Вставка дуги
+    void insertEdge(int from, int to, double weight) {
+        log({GraphOp::InsertEdge, from, to, weight});
     }
 
-    // Поиск дуги (возвращает индекс или -1)
-    int findEdge(int from, int to) {
-        for (int i = H[from]; i != -1; i = L[i]) {
-            if (J[i] == to) {
-                return i;
-            }
+    // Удаление дуги
+    void removeEdge(int from, int to) {
+        log({GraphOp::RemoveEdge, from, to, 0.0});
+    }
+
+    // Удаление вершины
+    void removeVertex(int vertex) {
+        log({GraphOp::RemoveVertex, vertex, 0, 0.0});
+    }
+
+    // Групповая фиксация: запись накопленных записей одним вызовом и сброс на диск
+    void commit() {
+        if (buffer.empty()) return;
+        if (std::fwrite(buffer.data(), 1, buffer.size(), wal) != buffer.size()) {
+            throw std::runtime_error("Write-ahead log write failed");
         }
-        return -1;
+        syncFile(wal);
+        buffer.clear();
     }
 
-    // Печать всех дуг
-    void printEdges() {
-        for (size_t k = 0; k < I.size(); ++k) {
-            std::cout << "Edge " << k << ": " << I[k] << " -> " << J[k]
-                      << ", Weight: " << weights[k] << "\n";
+    // Контрольная точка: снимок нового поколения, затем новый пустой журнал
+    void checkpoint() {
+        commit();
+        std::string temporary = checkpointPath() + ".tmp";
+        std::FILE* file = std::fopen(temporary.c_str(), "wb");
+        uint64_t next = generation + 1;
+        bool ok = file && std::fwrite(&next, 8, 1, file) == 1 && writeSnapshot(file, graph);
+        if (file) {
+            syncFile(file);
+            std::fclose(file);
         }
+        if (!ok) throw std::runtime_error("Checkpoint write failed");
+        std::filesystem::rename(temporary, checkpointPath());
+        syncDirectory(directory);
+
+        std::fclose(wal);
+        std::filesystem::remove(walPath(generation));
+        generation = next;
+        wal = std::fopen(walPath(generation).c_str(), "ab");
+        if (!wal) throw std::runtime_error("Cannot open write-ahead log in " + directory);
+        loggedSinceCheckpoint = 0;
     }
 
-    // Печать всех вершин
-    void printVertices() {
-        std::cout << "Vertices: ";
-        for (const int &v : vertices) {
-            std::cout << v << " ";
+    // Число записей журнала, применённых при восстановлении
+    size_t replayedRecords() const {
+        return replayed;
+    }
+
+private:
+    std::string directory;
+    uint64_t generation = 0;
+    std::FILE* wal = nullptr;
+    std::string buffer; // Записи текущей группы
+    size_t loggedSinceCheckpoint = 0;
+    size_t replayed = 0;
+
+    std::string checkpointPath() const {
+        return directory + "/checkpoint.bin";
+    }
+
+    std::string walPath(uint64_t gen) const {
+        return directory + "/wal-" + std::to_string(gen) + ".log";
+    }
+
+    void log(const MutationRecord& record) {
+        char encoded[mutationRecordSize];
+        encodeRecord(record, encoded);
+        buffer.append(encoded, mutationRecordSize);
+        applyRecord(graph, record);
+        ++loggedSinceCheckpoint;
+        if (buffer.size() >= groupSize * mutationRecordSize) commit();
+        if (loggedSinceCheckpoint >= checkpointInterval) checkpoint();
+    }
+
+    // Повтор хвоста журнала; оборванная или повреждённая запись завершает журнал
+    void replayLog() {
+        std::FILE* file = std::fopen(walPath(generation).c_str(), "rb");
+        if (!file) return;
+        char encoded[mutationRecordSize];
+        MutationRecord record;
+        long valid = 0;
+        while (std::fread(encoded, 1, mutationRecordSize, file) == mutationRecordSize &&
+               decodeRecord(encoded, record)) {
+            applyRecord(graph, record);
+            ++replayed;
+            valid += mutationRecordSize;
         }
-        std::cout << "\n";
+        std::fclose(file);
+        // Отсечение оборванного хвоста, чтобы новые записи шли за последней целой
+        std::filesystem::resize_file(walPath(generation), valid);
+        loggedSinceCheckpoint = replayed;
     }
 };
 
-// Список смежности
-class AdjacencyListGraph {
+// Размер записи трассы по типу операции
+inline size_t traceRecordSize(GraphOp op) {
+    switch (op) {
+        case GraphOp::InsertEdge: return 17;
+        case GraphOp::RemoveEdge:
+        case GraphOp::FindEdge: return 9;
+        default: return 5;
+    }
+}
+
+// Запись трассы операций: каждый публичный вызов графа пишется в файл без контрольных сумм.
+// Трасса: "KITT", затем записи op (1 байт), from (4), to (4, кроме операций над вершиной),
+// weight (8, только у InsertEdge). Трасса переносима между представлениями, поэтому операций
+// по индексу дуги у TracedGraph нет, а сам граф доступен только для чтения
+template<class Graph = EdgeListGraph>
+class TracedGraph {
 public:
-    std::unordered_map<int, std::list<std::pair<int, double>>> adjList; // Словарь списков смежности
-    std::unordered_set<int> vertices; // Набор уникальных вершин
+    explicit TracedGraph(const std::string& path, Graph empty = Graph()) : graph(std::move(empty)) {
+        trace = std::fopen(path.c_str(), "wb");
+        if (!trace || std::fwrite("KITT", 1, 4, trace) != 4) throw std::runtime_error("Cannot open trace " + path);
+    }
 
-    // Вставка вершины
-    void insertVertex(int vertex) {
-        vertices.insert(vertex);
-        if (adjList.find(vertex) == adjList.end()) {
-            adjList[vertex] = std::list<std::pair<int, double>>(); // Инициализация списка для вершины
+    TracedGraph(const TracedGraph&) = delete;
+    TracedGraph& operator=(const TracedGraph&) = delete;
+
+    ~TracedGraph() {
+        try {
+            flush();
+        } catch (const std::runtime_error& e) {
+            std::cerr << "TracedGraph: " << e.what() << "\n";
         }
+        std::fclose(trace);
+    }
+
+    // Граф без записи в трассу
+    const Graph& view() const {
+        return graph;
+    }
+
+    void insertVertex(int vertex) {
+        record(GraphOp::InsertVertex, vertex);
+        graph.insertVertex(vertex);
     }
 
-    // Вставка дуги
     void insertEdge(int from, int to, double weight) {
-        adjList[from].emplace_back(to, weight);
-        insertVertex(from);
-        insertVertex(to);
+        record(GraphOp::InsertEdge, from, to, weight);
+        graph.insertEdge(from, to, weight);
+    }
+
+    // Пакетная вставка пишется в трассу по одной дуге: воспроизведение даёт тот же граф
+    void insertEdges(const std::vector<int>& from, const std::vector<int>& to, const std::vector<double>& weight) {
+        checkEdgeBatch(from, to, weight);
+        for (size_t k = 0; k < from.size(); ++k) record(GraphOp::InsertEdge, from[k], to[k], weight[k]);
+        graph.insertEdges(from, to, weight);
     }
 
-    // Удаление дуги
     void removeEdge(int from, int to) {
-        if (adjList.find(from) != adjList.end()) {
-            adjList[from].remove_if([to](const std::pair<int, double>& edge) {
-                return edge.first == to;
-            });
-        }
+        record(GraphOp::RemoveEdge, from, to);
+        graph.removeEdge(from, to);
     }
 
-    // Удаление вершины
     void removeVertex(int vertex) {
-        adjList.erase(vertex);
-        for (auto& [key, neighbors] : adjList) {
-            neighbors.remove_if([vertex](const std::pair<int, double>& edge) {
-                return edge.first == vertex;
-            });
-        }
-        vertices.erase(vertex);
+        record(GraphOp::RemoveVertex, vertex);
+        graph.removeVertex(vertex);
     }
 
-    // Поиск вершины
     bool findVertex(int vertex) {
-        return vertices.find(vertex) != vertices.end();
+        record(GraphOp::FindVertex, vertex);
+        return graph.findVertex(vertex);
     }
 
-    // Поиск дуги
-    bool findEdge(int from, int to) {
-        if (adjList.find(from) != adjList.end()) {
-            for (const auto& edge : adjList[from]) {
-                if (edge.first == to) {
-                    return true;
-                }
-            }
+    auto findEdge(int from, int to) {
+        record(GraphOp::FindEdge, from, to);
+        return graph.findEdge(from, to);
+    }
+
+    template<class F>
+    void forEachNeighbor(int vertex, F f) {
+        record(GraphOp::ForEachNeighbor, vertex);
+        graph.forEachNeighbor(vertex, f);
+    }
+
+    // Запись накопленного буфера в файл
+    void flush() {
+        if (!buffer.empty() && std::fwrite(buffer.data(), 1, buffer.size(), trace) != buffer.size()) {
+            throw std::runtime_error("Trace write failed");
         }
-        return false;
+        buffer.clear();
+        std::fflush(trace);
     }
 
-    // Печать всех дуг
-    void printEdges() {
-        for (const auto& [vertex, neighbors] : adjList) {
-            for (const auto& [to, weight] : neighbors) {
-                std::cout << "Edge: " << vertex << " -> " << to
-                          << ", Weight: " << weight << "\n";
-            }
+private:
+    Graph graph;
+    std::FILE* trace = nullptr;
+    std::vector<char> buffer;
+
+    void record(GraphOp op, int from, int to = 0, double weight = 0.0) {
+        char bytes[17];
+        bytes[0] = static_cast<char>(op);
+        std::memcpy(bytes + 1, &from, 4);
+        size_t size = traceRecordSize(op);
+        if (size > 5) std::memcpy(bytes + 5, &to, 4);
+        if (size > 9) std::memcpy(bytes + 9, &weight, 8);
+        buffer.insert(buffer.end(), bytes, bytes + size);
+        if (buffer.size() >= (1 << 16)) flush();
+    }
+};
+
+// Чтение трассы целиком; false, если файл не является трассой или обрезан
+inline bool readTrace(const std::string& path, std::vector<MutationRecord>& records) {
+    std::ifstream in(path, std::ios::binary);
+    std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    if (data.compare(0, 4, "KITT") != 0) return false;
+    for (size_t position = 4; position < data.size();) {
+        MutationRecord record{static_cast<GraphOp>(data[position]), 0, 0, 0.0};
+        if (static_cast<uint8_t>(record.op) > static_cast<uint8_t>(GraphOp::ForEachNeighbor)) return false;
+        size_t size = traceRecordSize(record.op);
+        if (position + size > data.size()) return false;
+        std::memcpy(&record.from, data.data() + position + 1, 4);
+        if (size > 5) std::memcpy(&record.to, data.data() + position + 5, 4);
+        if (size > 9) std::memcpy(&record.weight, data.data() + position + 9, 8);
+        records.push_back(record);
+        position += size;
+    }
+    return true;
+}
+
+// Итоги воспроизведения трассы по типам операций; гистограмма задержек по степеням двойки наносекунд
+struct TraceReport {
+    static constexpr size_t opCount = static_cast<size_t>(GraphOp::ForEachNeighbor) + 1;
+    static constexpr std::array<const char*, opCount> names = {
+            "insertVertex", "insertEdge", "removeEdge", "removeVertex", "findVertex", "findEdge", "forEachNeighbor"};
+
+    std::array<size_t, opCount> counts{};
+    std::array<uint64_t, opCount> totalNanoseconds{};
+    std::array<std::array<size_t, 64>, opCount> histograms{}; // Корзина b: задержка в [2^b, 2^(b+1)) нс
+
+    void add(GraphOp op, uint64_t nanoseconds) {
+        size_t k = static_cast<size_t>(op);
+        ++counts[k];
+        totalNanoseconds[k] += nanoseconds;
+        int bucket = 0;
+        while (bucket < 63 && (nanoseconds >> (bucket + 1)) != 0) ++bucket;
+        ++histograms[k][bucket];
+    }
+
+    // Оценка процентиля (0..1) сверху: граница корзины, в которую он попадает
+    uint64_t percentile(GraphOp op, double fraction) const {
+        size_t k = static_cast<size_t>(op);
+        size_t target = static_cast<size_t>(std::ceil(fraction * counts[k])), seen = 0;
+        for (int bucket = 0; bucket < 64; ++bucket) {
+            seen += histograms[k][bucket];
+            if (seen >= target && seen > 0) return uint64_t(2) << bucket;
+        }
+        return 0;
+    }
+
+    // Печать: число операций, среднее, p50 и p99 по каждому типу
+    void print(std::ostream& out) const {
+        for (size_t k = 0; k < opCount; ++k) {
+            if (counts[k] == 0) continue;
+            GraphOp op = static_cast<GraphOp>(k);
+            out << names[k] << ": " << counts[k] << " ops, mean " << totalNanoseconds[k] / counts[k]
+                << " ns, p50 <= " << percentile(op, 0.5) << " ns, p99 <= " << percentile(op, 0.99) << " ns\n";
         }
     }
 };
 
+// Воспроизведение трассы на любом представлении с замером каждой операции
+template<class Graph>
+TraceReport replayTrace(const std::vector<MutationRecord>& records, Graph& graph) {
+    TraceReport report;
+    double sink = 0; // Результаты чтений, чтобы их не убрал оптимизатор
+    for (const MutationRecord& record : records) {
+        auto start = std::chrono::steady_clock::now();
+        switch (record.op) {
+            case GraphOp::FindVertex: sink += graph.findVertex(record.from); break;
+            case GraphOp::FindEdge: sink += graph.findEdge(record.from, record.to); break;
+            case GraphOp::ForEachNeighbor:
+                graph.forEachNeighbor(record.from, [&](int, double weight) { sink += weight; });
+                break;
+            default: applyRecord(graph, record); break;
+        }
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        report.add(record.op, std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+    }
+    volatile double keep = sink;
+    (void)keep;
+    return report;
+}
+
 // Тестирование реализаций
 void testRealization() {
     // Тестирование списка дуг (EdgeListGraph)
@@ -406,8 +5833,765 @@ void testRealization() {
 
     // Проверка поиска вершины
     std::cout << "Vertex 0 exists: " << adjListGraph.findVertex(0) << "\n";
+
+    // Неориентированный граф: каждое ребро хранится один раз
+    std::cout << "\nTesting undirected EdgeListGraph...\n";
+    EdgeListGraph undirectedGraph(true);
+    undirectedGraph.insertEdge(2, 1, 1.5);
+    undirectedGraph.insertEdge(1, 3, 2.0);
+    undirectedGraph.insertEdge(0, 1, 0.5);
+    undirectedGraph.printEdges();
+    std::cout << "Edge (1 -- 2) at index " << undirectedGraph.findEdge(1, 2)
+              << ", edge (2 -- 1) at index " << undirectedGraph.findEdge(2, 1) << "\n";
+    CsrGraph symmetricView(undirectedGraph);
+    std::cout << "Neighbors of 1 in symmetric CSR:";
+    symmetricView.forEachNeighbor(1, [](int to, double) { std::cout << " " << to; });
+    std::cout << "\nEdge (3 -- 1) in CSR: " << (symmetricView.findEdge(3, 1) != -1) << "\n";
+    undirectedGraph.removeEdge(3, 1);
+    std::cout << "Graph after removing edge 3 -- 1:\n";
+    undirectedGraph.printEdges();
+
+    // Столбцы свойств дуг и вершин
+    std::cout << "\nTesting property columns...\n";
+    EdgeListGraph propertyGraph;
+    int timestampColumn = propertyGraph.edgeProperties.addColumn<long long>("timestamp");
+    int capacityColumn = propertyGraph.edgeProperties.addColumn<double>("capacity", 1.0);
+    int labelColumn = propertyGraph.vertexProperties.addColumn<std::string>("label");
+    for (int k = 0; k < 4; ++k) {
+        propertyGraph.insertEdge(k, (k + 1) % 4, 1.0);
+        propertyGraph.edgeProperties.column<long long>(timestampColumn)[k] = 1000 + k;
+        propertyGraph.vertexProperties.column<std::string>(labelColumn)[k] = "v" + std::to_string(k);
+    }
+    propertyGraph.removeEdge(1, 2); // Строки свойств сдвигаются вместе с дугами
+    const auto& timestamps = propertyGraph.edgeProperties.column<long long>(timestampColumn);
+    for (size_t k = 0; k < propertyGraph.I.size(); ++k) {
+        std::cout << "Edge " << propertyGraph.I[k] << " -> " << propertyGraph.J[k]
+                  << ", timestamp: " << timestamps[k]
+                  << ", capacity: " << propertyGraph.edgeProperties.column<double>(capacityColumn)[k]
+                  << ", source label: " << propertyGraph.vertexProperties.column<std::string>(labelColumn)[propertyGraph.I[k]]
+                  << "\n";
+    }
+
+    // Порождённый подграф и окрестность вершины
+    std::cout << "\nTesting subgraph extraction...\n";
+    EdgeListGraph sourceGraph;
+    for (int k = 0; k < 10; ++k) {
+        sourceGraph.insertEdge(10 * k, 10 * (k + 1), k);
+        sourceGraph.insertEdge(10 * k, 10 * k + 5, -k);
+    }
+    Subgraph induced = extractInducedSubgraph(sourceGraph, {20, 30, 40, 35, 999});
+    std::cout << "Induced by {20, 30, 40, 35, 999}:\n";
+    induced.graph.printEdges();
+    Subgraph ego = extractEgoNetwork(sourceGraph, 30, 2);
+    std::cout << "2-hop ego network of 30, original ids:";
+    for (int v : ego.originalId) std::cout << " " << v;
+    std::cout << "\n";
+    ego.graph.printEdges();
+
+    // Временной граф и запросы по окну времени
+    std::cout << "\nTesting TemporalEdgeListGraph...\n";
+    TemporalEdgeListGraph temporalGraph;
+    temporalGraph.insertEdge(0, 1, 1.0, 100);
+    temporalGraph.insertEdge(0, 2, 2.0, 300);
+    temporalGraph.insertEdge(0, 3, 3.0, 200); // Вне порядка времени
+    temporalGraph.insertEdge(1, 2, 4.0, 150);
+    std::cout << "Neighbors of 0 within [150, 300]:";
+    temporalGraph.forEachNeighborInWindow(0, 150, 300, [](int to, double, long long time) {
+        std::cout << " " << to << "@" << time;
+    });
+    std::cout << "\nEdge (0 -> 1) within [0, 150]: " << temporalGraph.findEdge(0, 1, 0, 150) << "\n";
+    temporalGraph.expire(160);
+    std::cout << "Graph after expiring edges older than 160:\n";
+    temporalGraph.printEdges();
+
+    // Граф на упакованном массиве
+    std::cout << "\nTesting PackedMemoryArrayGraph...\n";
+    PackedMemoryArrayGraph pmaGraph;
+    for (int k = 0; k < 1000; ++k) {
+        pmaGraph.insertEdge(k % 10, (k * 37) % 101, k);
+    }
+    for (int k = 0; k < 1000; k += 2) {
+        pmaGraph.removeEdge(k % 10, (k * 37) % 101);
+    }
+    std::cout << "Edges after removals: " << pmaGraph.edgeCount() << "\n";
+    std::cout << "Edge (3 -> 10) exists: " << pmaGraph.findEdge(3, 10) << ", edge (2 -> 10) exists: "
+              << pmaGraph.findEdge(2, 10) << "\n";
+    std::cout << "First neighbors of 3 in order:";
+    int shown = 0;
+    pmaGraph.forEachNeighbor(3, [&](int to, double) {
+        if (shown++ < 8) std::cout << " " << to;
+    });
+    std::cout << " (" << shown << " total)\n";
+    pmaGraph.removeVertex(3);
+    std::cout << "Edges after removing vertex 3: " << pmaGraph.edgeCount() << "\n";
+
+    // Векторный просмотр столбцов I/J
+    std::cout << "\nTesting vectorized scans...\n";
+    EdgeListGraph scanGraph;
+    for (int k = 0; k < 100; ++k) {
+        scanGraph.insertEdge(k % 7, k % 11, k);
+    }
+    std::cout << "Edge (3 -> 5) at index " << scanGraph.findEdge(3, 5) << ", out-degree of 3: "
+              << scanGraph.outDegree(3) << ", in-degree of 5: " << scanGraph.inDegree(5) << "\n";
+    scanGraph.removeEdge(3, 5);
+    scanGraph.removeVertex(6);
+    std::cout << "Edges after removing edge 3 -> 5 and vertex 6: " << scanGraph.I.size() << "\n";
+
+    // Упорядоченный список дуг
+    std::cout << "\nTesting sorted EdgeListGraph...\n";
+    EdgeListGraph sortedGraph;
+    for (int k = 0; k < 20; ++k) {
+        sortedGraph.insertEdge((k * 7) % 5, (k * 3) % 4, k);
+    }
+    sortedGraph.sortEdges();
+    sortedGraph.insertEdge(2, 9, 100.0); // Попадает в буфер вставок
+    auto [rangeBegin, rangeEnd] = sortedGraph.sourceRange(2);
+    std::cout << "Sorted: " << sortedGraph.isSorted() << ", edges of 2 in sorted part: [" << rangeBegin << ", "
+              << rangeEnd << "), edge (2 -> 9) at index " << sortedGraph.findEdge(2, 9)
+              << ", edge (4 -> 1) at index " << sortedGraph.findEdge(4, 1) << "\n";
+    sortedGraph.removeEdge(1, 1);
+    std::cout << "Neighbors of 2:";
+    sortedGraph.forEachNeighbor(2, [](int to, double) { std::cout << " " << to; });
+    std::cout << "\n";
+
+    // Фильтр отсутствующих дуг
+    std::cout << "\nTesting edge filter...\n";
+    EdgeListGraph filteredGraph;
+    filteredGraph.enableEdgeFilter(4096);
+    for (int k = 0; k < 3000; ++k) {
+        filteredGraph.insertEdge(k, (k * 13 + 7) % 3000, 1.0);
+    }
+    filteredGraph.removeEdge(5, 72);
+    int falsePositives = 0;
+    for (int k = 0; k < 3000; ++k) {
+        if (filteredGraph.edgeFilter->mayContain(k, (k * 13 + 8) % 3000)) ++falsePositives;
+    }
+    std::cout << "Edge (5 -> 72) exists: " << (filteredGraph.findEdge(5, 72) != -1)
+              << ", edge (6 -> 85) exists: " << (filteredGraph.findEdge(6, 85) != -1)
+              << ", filter false positives: " << falsePositives << " of 3000\n";
+
+    // Граф, разбитый по узлам NUMA (два виртуальных узла по два потока)
+    std::cout << "\nTesting NumaPartitionedGraph...\n";
+    EdgeListGraph gridGraph;
+    for (int row = 0; row < 4; ++row) {
+        for (int col = 0; col < 4; ++col) {
+            int v = row * 4 + col;
+            if (col < 3) gridGraph.insertEdge(v, v + 1, 1.0);
+            if (row < 3) gridGraph.insertEdge(v, v + 4, 1.0);
+        }
+    }
+    NumaPartitionedGraph numaGraph(gridGraph, 2, 2);
+    for (int p = 0; p < numaGraph.nodeCount(); ++p) {
+        std::cout << "Node " << p << " owns vertices [" << numaGraph.partitions[p].firstVertex << ", "
+                  << numaGraph.partitions[p].lastVertex << ") with " << numaGraph.partitions[p].targets.size()
+                  << " edges\n";
+    }
+    std::cout << "BFS distances from 0:";
+    for (int d : numaGraph.bfs(0)) std::cout << " " << d;
+    std::cout << "\n";
+
+    // Разбиение графа на части
+    std::cout << "\nTesting graph partitioner...\n";
+    AdjacencyListGraph clusteredGraph;
+    for (int cluster = 0; cluster < 4; ++cluster) {
+        for (int k = 0; k < 50; ++k) {
+            int v = cluster * 50 + k;
+            clusteredGraph.insertEdge(v, cluster * 50 + (k + 1) % 50, 1.0);
+            clusteredGraph.insertEdge(v, cluster * 50 + (k * 7 + 3) % 50, 1.0);
+        }
+        clusteredGraph.insertEdge(cluster * 50, ((cluster + 1) % 4) * 50 + 25, 1.0); // Связь между кластерами
+    }
+    GraphPartitioning partitioning = partitionGraph(clusteredGraph, 4);
+    std::cout << "Edge cut: " << partitioning.edgeCut << "\n";
+    for (size_t p = 0; p < partitioning.shards.size(); ++p) {
+        const GraphShard& shard = partitioning.shards[p];
+        std::cout << "Shard " << p << ": " << shard.ownedCount << " vertices, " << shard.graph.I.size()
+                  << " edges, " << shard.ghostOwner.size() << " ghosts, " << shard.boundary.size()
+                  << " boundary vertices\n";
+    }
+
+#ifdef __unix__
+    // Части графа в отдельных процессах и распределённый поиск в ширину
+    std::cout << "\nTesting ShardedGraphCluster...\n";
+    {
+        ShardedGraphCluster cluster(partitioning);
+        std::unordered_map<int, int> clusterDistance = cluster.bfs(0);
+        int farthest = 0;
+        for (const auto& [vertex, d] : clusterDistance) farthest = std::max(farthest, d);
+        std::cout << cluster.shardCount() << " shard processes, BFS from 0 reached " << clusterDistance.size()
+                  << " vertices, eccentricity " << farthest << ", distance to 75: " << clusterDistance[75] << "\n";
+        std::cout << "Neighbors of 50 from its shard:";
+        for (auto [to, weight] : cluster.neighbors(50)) std::cout << " " << to;
+        std::cout << "\n";
+    }
+#endif
+
+    // Граф во внешней памяти с кэшем блоков
+    std::cout << "\nTesting ExternalCsrGraph...\n";
+    {
+        EdgeListGraph largeGraph;
+        std::mt19937 externalRandom(7);
+        const int externalVertices = 20000;
+        for (int v = 0; v < externalVertices; ++v) {
+            for (int k = 1; k <= 4; ++k) largeGraph.insertEdge(v, (v + k) % externalVertices, k);
+            largeGraph.insertEdge(v, externalRandom() % externalVertices, 10.0);
+        }
+        CsrGraph inMemory(largeGraph);
+        std::string externalPath = (std::filesystem::temp_directory_path() / "kitx-external-graph.bin").string();
+        ExternalCsrGraph::write(externalPath, inMemory, 1024);
+        std::vector<int> expected = ExternalCsrGraph(externalPath).bfs(0);
+        for (size_t cacheBlocks : {8, 24, 48, 128}) {
+            ExternalCsrGraph external(externalPath, cacheBlocks);
+            auto start = std::chrono::high_resolution_clock::now();
+            bool same = external.bfs(0) == expected;
+            auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::high_resolution_clock::now() - start).count();
+            ExternalCsrGraph::CacheStats stats = external.cacheStats();
+            std::cout << "Cache " << cacheBlocks << " of " << (external.edgeCount() + 1023) / 1024
+                      << " blocks: BFS " << (same ? "matches" : "DIFFERS") << ", " << stats.misses << " misses, "
+                      << stats.prefetched << " prefetched, " << elapsed << " us\n";
+        }
+        ExternalCsrGraph external(externalPath, 16);
+        size_t externalEdges = 0;
+        external.forEachEdge([&](int, int, double) { ++externalEdges; });
+        std::cout << "Edges scanned: " << externalEdges << ", findEdge(5, 7): " << external.findEdge(5, 7)
+                  << " (in memory " << inMemory.findEdge(5, 7) << "), findEdge(5, 4): " << external.findEdge(5, 4) << "\n";
+        std::filesystem::remove(externalPath);
+    }
+
+    // Счётчики внутренней работы операций
+    std::cout << "\nTesting operation counters...\n";
+    if (!GraphStats::enabled) {
+        std::cout << "Counters are disabled, rebuild with GRAPH_STATS to collect them\n";
+    } else {
+        auto measure = [](const char* title, auto operation) {
+            GraphStatsSnapshot before = GraphStats::snapshot();
+            operation();
+            std::cout << title << ":\n" << GraphStats::exportText(GraphStats::difference(GraphStats::snapshot(), before));
+        };
+        BundledEdgeListGraph bundledCounted(100);
+        AdjacencyListGraph adjacencyCounted;
+        for (int v = 0; v < 100; ++v) {
+            for (int k = 1; k <= 5; ++k) {
+                bundledCounted.insertEdge(v, (v + k) % 100, 1.0);
+                adjacencyCounted.insertEdge(v, (v + k) % 100, 1.0);
+            }
+        }
+        measure("BundledEdgeListGraph::removeEdge(10, 15)", [&] { bundledCounted.removeEdge(10, 15); });
+        measure("AdjacencyListGraph::findEdge(10, 15)", [&] { adjacencyCounted.findEdge(10, 15); });
+        measure("AdjacencyListGraph::removeVertex(20)", [&] { adjacencyCounted.removeVertex(20); });
+    }
+
+    // Буферизованная выгрузка графа
+    std::cout << "\nTesting graph exporters...\n";
+    {
+        EdgeListGraph exportedGraph;
+        std::mt19937 exportRandom(11);
+        for (int k = 0; k < 300000; ++k) {
+            exportedGraph.insertEdge(exportRandom() % 50000, exportRandom() % 50000, (exportRandom() % 64) * 0.25);
+        }
+        std::filesystem::path exportDirectory = std::filesystem::temp_directory_path();
+        std::string streamPath = (exportDirectory / "kitg-export-stream.txt").string();
+        std::string exportPath = (exportDirectory / "kitg-export.txt").string();
+
+        auto start = std::chrono::high_resolution_clock::now();
+        {
+            std::ofstream stream(streamPath);
+            exportedGraph.forEachEdge([&](int from, int to, double weight) {
+                stream << from << " " << to << " " << weight << "\n";
+            });
+        }
+        auto streamTime = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::high_resolution_clock::now() - start).count();
+        start = std::chrono::high_resolution_clock::now();
+        exportGraph(exportedGraph, exportPath, ExportFormat::EdgeList);
+        auto exportTime = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::high_resolution_clock::now() - start).count();
+        auto readFile = [](const std::string& path) {
+            std::ifstream in(path, std::ios::binary);
+            return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        };
+        std::cout << "Edge list via <<: " << streamTime << " ms, exportGraph: " << exportTime << " ms, files "
+                  << (readFile(streamPath) == readFile(exportPath) ? "match" : "DIFFER") << "\n";
+
+        EdgeListGraph smallGraph(true);
+        smallGraph.insertEdge(2, 1, 1.5);
+        smallGraph.insertEdge(2, 3, 4.0);
+        exportGraph(smallGraph, exportPath, ExportFormat::Csv);
+        std::cout << "CSV:\n" << readFile(exportPath);
+        exportGraph(smallGraph, exportPath, ExportFormat::Dot);
+        std::cout << "DOT:\n" << readFile(exportPath);
+
+        exportGraph(CsrGraph(exportedGraph), exportPath, ExportFormat::Binary);
+        EdgeListGraph restored;
+        std::FILE* snapshot = std::fopen(exportPath.c_str(), "rb");
+        bool restoredOk = snapshot && readSnapshot(snapshot, restored);
+        if (snapshot) std::fclose(snapshot);
+        std::cout << "Binary snapshot restored: " << (restoredOk ? "yes" : "no") << ", " << restored.I.size()
+                  << " edges, " << restored.vertices.size() << " vertices\n";
+        std::filesystem::remove(streamPath);
+        std::filesystem::remove(exportPath);
+    }
+
+    // Персистентный граф: снимки за O(1) и откат
+    std::cout << "\nTesting PersistentGraph...\n";
+    {
+        PersistentGraph base;
+        AdjacencyListGraph baseAdjacency;
+        std::mt19937 versionRandom(5);
+        for (int k = 0; k < 100000; ++k) {
+            int from = versionRandom() % 20000, to = versionRandom() % 20000;
+            base.insertEdge(from, to, 1.0);
+            baseAdjacency.insertEdge(from, to, 1.0);
+        }
+        auto start = std::chrono::high_resolution_clock::now();
+        AdjacencyListGraph adjacencyCopy = baseAdjacency;
+        auto copyTime = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::high_resolution_clock::now() - start).count();
+        start = std::chrono::high_resolution_clock::now();
+        PersistentGraph branch = base;
+        auto snapshotTime = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::high_resolution_clock::now() - start).count();
+        std::cout << "AdjacencyListGraph copy: " << copyTime << " us, PersistentGraph snapshot: " << snapshotTime
+                  << " us\n";
+
+        branch.insertEdge(1, 2, 7.0);
+        branch.removeVertex(3);
+        std::cout << "Branch: " << branch.vertexCount() << " vertices, " << branch.edgeCount() << " edges; base: "
+                  << base.vertexCount() << " vertices, " << base.edgeCount() << " edges\n";
+        std::cout << "Base still has vertex 3: " << (base.findVertex(3) ? "yes" : "no") << ", branch: "
+                  << (branch.findVertex(3) ? "yes" : "no") << ", nodes shared with base: "
+                  << PersistentGraph::sharedNodes(base, branch) << "\n";
+
+        // Откат неудачного пакета — возврат к сохранённой версии
+        PersistentGraph beforeBatch = branch;
+        for (int k = 0; k < 1000; ++k) branch.insertEdge(k, k + 1, 0.5);
+        branch = beforeBatch;
+        std::cout << "After rollback: " << branch.edgeCount() << " edges, findEdge(1, 2): "
+                  << (branch.findEdge(1, 2) ? "yes" : "no") << "\n";
+    }
+
+    // Дефрагментация пучков
+    std::cout << "\nTesting BundledEdgeListGraph::defragment...\n";
+    {
+        const int fragmentedVertices = 20000;
+        BundledEdgeListGraph fragmented(fragmentedVertices);
+        std::mt19937 fragmentRandom(13);
+        for (int k = 0; k < 400000; ++k) {
+            fragmented.insertEdge(fragmentRandom() % fragmentedVertices, fragmentRandom() % fragmentedVertices, k);
+        }
+        auto walkBundles = [&] {
+            auto start = std::chrono::high_resolution_clock::now();
+            double sum = 0;
+            for (int v = 0; v < fragmentedVertices; ++v) {
+                fragmented.forEachNeighbor(v, [&](int, double weight) { sum += weight; });
+            }
+            auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::high_resolution_clock::now() - start).count();
+            return std::make_pair(sum, elapsed);
+        };
+        auto [sumBefore, timeBefore] = walkBundles();
+        int steps = 1;
+        while (!fragmented.defragment(std::chrono::microseconds(2000))) ++steps;
+        auto [sumAfter, timeAfter] = walkBundles();
+        bool contiguous = true;
+        for (size_t k = 0; k + 1 < fragmented.L.size(); ++k) {
+            if (fragmented.L[k] != -1 && fragmented.L[k] != static_cast<int>(k) + 1) contiguous = false;
+        }
+        std::cout << "Bundle walk before: " << timeBefore << " us, after: " << timeAfter << " us, " << steps
+                  << " budgeted steps, bundles contiguous: " << (contiguous ? "yes" : "no") << ", weights "
+                  << (sumBefore == sumAfter ? "preserved" : "CHANGED") << "\n";
+
+        // Удаление после дефрагментации: цепочки идут по возрастанию индексов
+        BundledEdgeListGraph small(4);
+        for (int k = 0; k < 3; ++k) small.insertEdge(0, 1, k);
+        small.insertEdge(1, 2, 9);
+        small.insertEdge(0, 3, 4);
+        small.defragment();
+        small.removeEdge(0, 1);
+        bool edgeRemoved = small.findEdge(0, 1) == -1 && small.I.size() == 2;
+        small.defragment();
+        small.removeVertex(0);
+        bool vertexRemoved = small.findEdge(0, 3) == -1 && small.I.size() == 1 && small.findEdge(1, 2) == 0;
+        std::cout << "Removal after defragment: edges " << (edgeRemoved ? "removed" : "LEFT BEHIND") << ", vertex "
+                  << (vertexRemoved ? "removed" : "LEFT BEHIND") << "\n";
+    }
+
+    // Запись и воспроизведение трассы операций
+    std::cout << "\nTesting operation trace replay...\n";
+    {
+        std::string tracePath = (std::filesystem::temp_directory_path() / "kitg-operations.trace").string();
+        {
+            TracedGraph<AdjacencyListGraph> traced(tracePath);
+            std::mt19937 traceRandom(17);
+            for (int k = 0; k < 20000; ++k) {
+                int from = traceRandom() % 2000, to = traceRandom() % 2000;
+                switch (traceRandom() % 10) {
+                    case 0: traced.removeEdge(from, to); break;
+                    case 1: traced.forEachNeighbor(from, [](int, double) {}); break;
+                    case 2: traced.findVertex(from); break;
+                    case 3: case 4: case 5: traced.findEdge(from, to); break;
+                    default: traced.insertEdge(from, to, 1.0); break;
+                }
+                if (k % 5000 == 4999) traced.removeVertex(from);
+            }
+            traced.insertEdges({1, 2, 3}, {2, 3, 1}, {0.5, 0.5, 0.5});
+        }
+        std::vector<MutationRecord> traceRecords;
+        bool traceOk = readTrace(tracePath, traceRecords);
+        std::cout << "Trace: " << (traceOk ? "valid" : "INVALID") << ", " << traceRecords.size() << " operations, "
+                  << std::filesystem::file_size(tracePath) << " bytes\n";
+        AdjacencyListGraph adjacencyReplay;
+        BundledEdgeListGraph bundledReplay(2000);
+        EdgeListGraph edgeListReplay;
+        TraceReport adjacencyReport = replayTrace(traceRecords, adjacencyReplay);
+        TraceReport bundledReport = replayTrace(traceRecords, bundledReplay);
+        TraceReport edgeListReport = replayTrace(traceRecords, edgeListReplay);
+        std::cout << "AdjacencyListGraph:\n";
+        adjacencyReport.print(std::cout);
+        std::cout << "BundledEdgeListGraph:\n";
+        bundledReport.print(std::cout);
+        std::cout << "EdgeListGraph:\n";
+        edgeListReport.print(std::cout);
+        std::filesystem::remove(tracePath);
+    }
+
+    // Сжатые веса дуг: точность и скорость обхода
+    std::cout << "\nTesting quantized weights...\n";
+    {
+        EdgeListGraph weightedGraph;
+        std::mt19937 weightRandom(19);
+        std::uniform_real_distribution<double> logWeight(-2.0, 3.0);
+        for (int k = 0; k < 400000; ++k) {
+            weightedGraph.insertEdge(weightRandom() % 20000, weightRandom() % 20000,
+                                     std::round(std::pow(10.0, logWeight(weightRandom)) * 1000) / 1000);
+        }
+        CsrGraph exact(weightedGraph);
+        auto timeTraversal = [&](const auto& g) {
+            auto start = std::chrono::high_resolution_clock::now();
+            double sum = 0;
+            for (int v = 0; v < g.vertexSlots(); ++v) g.forEachNeighbor(v, [&](int, double weight) { sum += weight; });
+            auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::high_resolution_clock::now() - start).count();
+            return std::make_pair(sum, elapsed);
+        };
+        auto [exactSum, exactTime] = timeTraversal(exact);
+        std::cout << "double: 8 bytes/edge, traversal " << exactTime << " us\n";
+        const std::pair<WeightFormat, const char*> formats[] = {
+                {WeightFormat::Half, "fp16"}, {WeightFormat::BFloat16, "bf16"}, {WeightFormat::Codebook, "codebook"}};
+        for (auto [format, name] : formats) {
+            QuantizedCsrGraph quantized(exact, format);
+            double maxError = 0, meanError = 0;
+            for (size_t k = 0; k < exact.weights.size(); ++k) {
+                double error = std::abs(quantized.weight(k) - exact.weights[k]) / exact.weights[k];
+                maxError = std::max(maxError, error);
+                meanError += error / exact.weights.size();
+            }
+            auto [sum, elapsed] = timeTraversal(quantized);
+            std::cout << name << ": " << static_cast<double>(quantized.weights.bytes()) / exact.weights.size()
+                      << " bytes/edge, relative error mean " << meanError << " max " << maxError << ", traversal "
+                      << elapsed << " us, weight sum drift " << std::abs(sum - exactSum) / exactSum << "\n";
+        }
+
+        // Веса больше последнего уровня кэша. Словарь сюда не входит: его построение на 16M дуг занимает секунды,
+        // а декодирование сбором (gather) упирается в вычисления, а не в память
+        CsrGraph large;
+        const int largeVertices = 1 << 19, largeDegree = 32;
+        large.offsets.resize(largeVertices + 1);
+        large.targets.resize(size_t(largeVertices) * largeDegree);
+        large.weights.resize(large.targets.size());
+        for (int v = 0; v <= largeVertices; ++v) large.offsets[v] = v * largeDegree;
+        for (int v = 0; v < largeVertices; ++v) {
+            auto begin = large.targets.begin() + large.offsets[v], end = large.targets.begin() + large.offsets[v + 1];
+            for (auto it = begin; it != end; ++it) *it = weightRandom() % largeVertices;
+            std::sort(begin, end);
+            large.vertices.insert(v);
+        }
+        std::vector<double> weightPool(4096);
+        for (double& weight : weightPool) weight = std::round(std::pow(10.0, logWeight(weightRandom)) * 1000) / 1000;
+        for (double& weight : large.weights) weight = weightPool[weightRandom() % weightPool.size()];
+        // Лучшее из трёх проходов: взвешенные степени одним вызовом ядра и сумма весов через forEachEdge
+        auto timeSweeps = [&](const auto& g) {
+            long long bestDegrees = LLONG_MAX, bestEdges = LLONG_MAX;
+            double degreeSum = 0, edgeSum = 0;
+            for (int pass = 0; pass < 3; ++pass) {
+                auto start = std::chrono::high_resolution_clock::now();
+                std::vector<double> strength = g.weightedDegrees();
+                auto middle = std::chrono::high_resolution_clock::now();
+                edgeSum = 0;
+                g.forEachEdge([&](int, int, double weight) { edgeSum += weight; });
+                auto end = std::chrono::high_resolution_clock::now();
+                degreeSum = std::accumulate(strength.begin(), strength.end(), 0.0);
+                bestDegrees = std::min<long long>(
+                        bestDegrees, std::chrono::duration_cast<std::chrono::microseconds>(middle - start).count());
+                bestEdges = std::min<long long>(
+                        bestEdges, std::chrono::duration_cast<std::chrono::microseconds>(end - middle).count());
+            }
+            return std::make_tuple(degreeSum, edgeSum, bestDegrees, bestEdges);
+        };
+        auto [largeDegreeSum, largeEdgeSum, largeDegrees, largeEdges] = timeSweeps(large);
+        std::cout << "Weights larger than LLC (" << (large.weights.size() * 8 >> 20) << " MB as double), "
+                  << "weighted degrees / forEachEdge: double " << largeDegrees << " / " << largeEdges << " us";
+        for (auto [format, name] : {formats[0], formats[1]}) {
+            QuantizedCsrGraph quantized(large, format);
+            auto [degreeSum, edgeSum, degrees, edges] = timeSweeps(quantized);
+            bool close = std::abs(degreeSum - largeDegreeSum) / largeDegreeSum < 0.01
+                         && std::abs(edgeSum - largeEdgeSum) / largeEdgeSum < 0.01;
+            std::cout << ", " << name << " " << degrees << " / " << edges << " us" << (close ? "" : " (SUM MISMATCH)");
+        }
+        std::cout << "\n";
+    }
+
+    // Ленивое удаление вершин списка смежности
+    std::cout << "\nTesting lazy vertex deletion...\n";
+    {
+        auto churn = [](bool lazy) {
+            AdjacencyListGraph churned;
+            if (lazy) churned.enableLazyDeletion(0.25);
+            std::mt19937 churnRandom(23);
+            for (int k = 0; k < 20000; ++k) churned.insertEdge(churnRandom() % 2000, churnRandom() % 2000, 1.0);
+            auto start = std::chrono::high_resolution_clock::now();
+            for (int v = 0; v < 600; ++v) churned.removeVertex(v * 3);
+            auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::high_resolution_clock::now() - start).count();
+            std::cout << (lazy ? "Lazy" : "Eager") << " removal of 600 vertices: " << elapsed << " ms, "
+                      << churned.edgeCount() << " live edges, " << churned.pendingDeletions()
+                      << " deletions pending, findEdge(1, 3): " << churned.findEdge(1, 3) << "\n";
+
+            // Повторная вставка удалённых номеров: старые дуги в них остаются скрытыми без вычистки
+            size_t liveEdges = churned.edgeCount();
+            start = std::chrono::high_resolution_clock::now();
+            for (int v = 0; v < 600; ++v) churned.insertEdge(v * 3, v * 3 + 1, 1.0);
+            elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::high_resolution_clock::now() - start).count();
+            bool revived = false;
+            churned.forEachNeighbor(1, [&](int to, double) { revived |= to % 3 == 0 && to < 1800; });
+            std::cout << "  re-insertion of 600 removed ids: " << elapsed << " ms, "
+                      << churned.edgeCount() - liveEdges << " new edges, " << churned.pendingDeletions()
+                      << " deletions pending" << (revived ? " (STALE ARC REVIVED)" : "") << "\n";
+        };
+        churn(false);
+        churn(true);
+    }
+
+    // Большие страницы для массивов графа: оба графа строятся заранее, проходы чередуются,
+    // берётся лучший из пяти. Массивы (~160 МБ) много больше охвата STLB страницами 4 КБ (единицы МБ)
+    std::cout << "\nTesting huge page allocation policy...\n";
+    {
+        const int pagedVertices = 1 << 18;
+        const PagePolicy policies[] = {PagePolicy::SmallPages, PagePolicy::HugePages};
+        std::vector<std::unique_ptr<HugePageBundledEdgeListGraph>> paged;
+        std::vector<long long> hugeKb;
+        for (PagePolicy policy : policies) {
+            graphPagePolicy() = policy;
+            long long hugeBefore = anonHugePagesKb();
+            paged.push_back(std::make_unique<HugePageBundledEdgeListGraph>(pagedVertices));
+            std::mt19937 pageRandom(29);
+            for (int k = 0; k < (1 << 23); ++k) {
+                paged.back()->insertEdge(pageRandom() % pagedVertices, pageRandom() % pagedVertices, k);
+            }
+            hugeKb.push_back(hugeBefore >= 0 ? anonHugePagesKb() - hugeBefore : -1);
+        }
+        graphPagePolicy() = PagePolicy::Default;
+
+        // Обход пучков случайных вершин: цепочки L прыгают по всем массивам
+        std::mt19937 probeRandom(31);
+        std::vector<int> probes(1 << 14);
+        for (int& v : probes) v = probeRandom() % pagedVertices;
+        DtlbMissCounter dtlbMisses;
+        long long best[2] = {LLONG_MAX, LLONG_MAX}, misses[2] = {-1, -1};
+        double sums[2] = {0, 0};
+        for (int pass = 0; pass < 5; ++pass) {
+            for (int p = 0; p < 2; ++p) {
+                double sum = 0;
+                dtlbMisses.start();
+                auto start = std::chrono::high_resolution_clock::now();
+                for (int v : probes) paged[p]->forEachNeighbor(v, [&](int, double weight) { sum += weight; });
+                auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+                        std::chrono::high_resolution_clock::now() - start).count();
+                long long passMisses = dtlbMisses.stop();
+                if (elapsed < best[p]) {
+                    best[p] = elapsed;
+                    misses[p] = passMisses;
+                }
+                sums[p] = sum;
+            }
+        }
+        for (int p = 0; p < 2; ++p) {
+            std::cout << (policies[p] == PagePolicy::HugePages ? "Huge pages: " : "4K pages: ") << best[p]
+                      << " us bundle walk (best of 5), dTLB misses: "
+                      << (misses[p] >= 0 ? std::to_string(misses[p]) : "unavailable") << ", THP-backed growth: "
+                      << (hugeKb[p] >= 0 ? std::to_string(hugeKb[p]) + " KB" : "unknown")
+                      << (sums[p] == sums[0] ? "" : " (SUM MISMATCH)") << "\n";
+        }
+    }
+
+#ifdef __unix__
+    // Конвейерная загрузка списка дуг: чтение, разбор и вставка перекрываются
+    std::cout << "\nTesting loadEdgeListFile...\n";
+    {
+        EdgeListGraph source;
+        std::mt19937 loadRandom(17);
+        for (int k = 0; k < 400000; ++k) {
+            source.insertEdge(loadRandom() % 60000, loadRandom() % 60000, (loadRandom() % 32) * 0.5);
+        }
+        std::string loadPath = (std::filesystem::temp_directory_path() / "kitg-load.txt").string();
+        exportGraph(source, loadPath, ExportFormat::EdgeList);
+
+        auto start = std::chrono::high_resolution_clock::now();
+        EdgeListGraph serial;
+        {
+            std::ifstream in(loadPath);
+            int from, to;
+            double weight;
+            while (in >> from >> to >> weight) serial.insertEdge(from, to, weight);
+        }
+        double serialSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+        std::cout << "ifstream: " << serial.I.size() << " edges, " << static_cast<long long>(serialSeconds * 1000)
+                  << " ms\n";
+        for (bool ioUring : {true, false}) {
+            EdgeListGraph loaded;
+            LoadStats stats = loadEdgeListFile(loadPath, loaded, size_t(1) << 20, 4, ioUring);
+            bool same = loaded.I == serial.I && loaded.J == serial.J && loaded.weights == serial.weights;
+            std::cout << (stats.ioUring ? "io_uring" : "pread pool") << ": " << stats.edges << " edges, "
+                      << static_cast<long long>(stats.seconds * 1000) << " ms, "
+                      << static_cast<long long>(stats.bytes / stats.seconds / (1 << 20)) << " MB/s, "
+                      << (same ? "matches" : "DIFFERS") << "\n";
+        }
+
+        // Заголовок CSV, комментарии и строки без веса
+        std::FILE* csv = std::fopen(loadPath.c_str(), "w");
+        std::fputs("from,to,weight\n# comment\n1,2,0.5\n\n2,3\n3,1,2", csv);
+        std::fclose(csv);
+        EdgeListGraph small;
+        LoadStats smallStats = loadEdgeListFile(loadPath, small, 8, 2);
+        std::cout << "CSV with small chunks: " << smallStats.edges << " edges\n";
+        small.printEdges();
+        std::filesystem::remove(loadPath);
+    }
+#endif
+
+    // Чередование независимых поисков: промахи кэша разных запросов перекрываются
+    std::cout << "\nTesting interleaved lookups...\n";
+    {
+        const int vertexCount = 200000;
+        std::mt19937 interleavedRandom(23);
+        EdgeListGraph edges;
+        BundledEdgeListGraph bundled(vertexCount);
+        for (int k = 0; k < 1000000; ++k) {
+            int from = interleavedRandom() % vertexCount, to = interleavedRandom() % vertexCount;
+            edges.insertEdge(from, to, 1.0);
+            bundled.insertEdge(from, to, 1.0);
+        }
+        std::vector<std::pair<int, int>> queries(300000);
+        for (auto& [from, to] : queries) {
+            from = interleavedRandom() % vertexCount;
+            to = interleavedRandom() % vertexCount;
+        }
+        for (size_t k = 0; k < queries.size(); k += 2) queries[k] = {edges.I[k], edges.J[k]};
+
+        auto microseconds = [](auto f) {
+            auto start = std::chrono::high_resolution_clock::now();
+            f();
+            return std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::high_resolution_clock::now() - start).count();
+        };
+        std::vector<int> expected(queries.size());
+        auto serialTime = microseconds([&] {
+            for (size_t k = 0; k < queries.size(); ++k) expected[k] = bundled.findEdge(queries[k].first, queries[k].second);
+        });
+        std::vector<int> batch;
+        auto interleavedTime = microseconds([&] { batch = batchFindEdges(bundled, queries, 16); });
+        std::cout << "BundledEdgeListGraph: findEdge loop " << serialTime << " us, width 16 " << interleavedTime
+                  << " us, results " << (batch == expected ? "match" : "DIFFER") << "\n";
+    }
+
+    // Журнал изменений и контрольные точки
+    std::cout << "\nTesting DurableGraph...\n";
+    std::string durableDirectory = (std::filesystem::temp_directory_path() / "kitg-durable-graph").string();
+    std::filesystem::remove_all(durableDirectory);
+    {
+        DurableGraph<> durableGraph(durableDirectory);
+        durableGraph.insertEdge(0, 1, 5.0);
+        durableGraph.insertEdge(1, 2, 3.0);
+        durableGraph.checkpoint();
+        durableGraph.insertEdge(2, 0, 2.5);
+        durableGraph.removeEdge(0, 1);
+    } // Закрытие фиксирует последнюю группу
+    {
+        DurableGraph<> recovered(durableDirectory);
+        std::cout << "Recovered graph, replayed " << recovered.replayedRecords() << " log records:\n";
+        recovered.graph.printEdges();
+    }
+    std::filesystem::remove_all(durableDirectory);
+
+    // Пакетная вставка с кратными дугами
+    std::cout << "\nTesting bulk insert with duplicate policies...\n";
+    std::vector<int> bulkFrom = {0, 1, 0, 2, 0, 1};
+    std::vector<int> bulkTo = {1, 2, 1, 0, 1, 2};
+    std::vector<double> bulkWeights = {5.0, 3.0, 2.0, 2.5, 4.0, 1.0};
+    const char* policyNames[] = {"KeepAll", "KeepFirst", "SumWeights", "MinWeight"};
+    for (int policy = 0; policy < 4; ++policy) {
+        EdgeListGraph bulkGraph;
+        bulkGraph.insertEdges(bulkFrom, bulkTo, bulkWeights, static_cast<DuplicatePolicy>(policy));
+        std::cout << policyNames[policy] << ":\n";
+        bulkGraph.printEdges();
+    }
+    BundledEdgeListGraph bulkBundled(3);
+    bulkBundled.insertEdges(bulkFrom, bulkTo, bulkWeights, DuplicatePolicy::SumWeights);
+    std::cout << "BundledEdgeListGraph, SumWeights, edge (0 -> 1) at index " << bulkBundled.findEdge(0, 1) << "\n";
+    AdjacencyListGraph bulkAdjacency;
+    bulkAdjacency.insertEdges(bulkFrom, bulkTo, bulkWeights, DuplicatePolicy::MinWeight);
+    std::cout << "AdjacencyListGraph, MinWeight:\n";
+    bulkAdjacency.printEdges();
+
+    // Тестирование адаптивного графа (AdaptiveGraph)
+    std::cout << "\nTesting AdaptiveGraph...\n";
+    AdaptiveGraph adaptiveGraph;
+    const char* layoutNames[] = {"EdgeList", "Adjacency", "Csr"};
+
+    // Загрузка: преобладают вставки
+    for (int k = 0; k < 8192; ++k) {
+        adaptiveGraph.insertEdge(k % 1000, (k * 7 + 1) % 1000, k * 0.5);
+    }
+    adaptiveGraph.waitMigration();
+    std::cout << "Layout after ingest: " << layoutNames[static_cast<int>(adaptiveGraph.layout())] << "\n";
+
+    // Чтение: преобладают поиски, граф переходит к CSR
+    int found = 0;
+    for (int k = 0; k < 8192; ++k) {
+        found += adaptiveGraph.findEdge(k % 1000, (k * 7 + 1) % 1000);
+    }
+    adaptiveGraph.removeEdge(0, 1); // Изменение во время переноса
+    adaptiveGraph.waitMigration();
+    std::cout << "Layout after reads: " << layoutNames[static_cast<int>(adaptiveGraph.layout())]
+              << ", found " << found << " edges\n";
+    std::cout << "Edge (0 -> 1) exists: " << adaptiveGraph.findEdge(0, 1) << "\n";
+
+    // Смешанная нагрузка: граф переходит к спискам смежности
+    for (int k = 0; k < 8192; ++k) {
+        if (k % 2) {
+            adaptiveGraph.insertEdge(k % 1000, k % 997, 1.0);
+        } else {
+            adaptiveGraph.removeEdge(k % 1000, k % 997);
+        }
+    }
+    adaptiveGraph.waitMigration();
+    std::cout << "Layout after mixed load: " << layoutNames[static_cast<int>(adaptiveGraph.layout())] << "\n";
+    int neighbors = 0;
+    adaptiveGraph.forEachNeighbor(3, [&](int, double) { ++neighbors; });
+    std::cout << "Vertex 3 has " << neighbors << " out-edges\n";
 }
 
-int main() {
+int main(int argc, char** argv) {
+#ifdef __unix__
+    // Процесс части ShardedGraphCluster, запущенный координатором
+    if (argc == 3 && std::strcmp(argv[1], ShardedGraphCluster::workerFlag) == 0) {
+        return ShardedGraphCluster::workerMain(std::atoi(argv[2]));
+    }
+#else
+    (void) argc;
+    (void) argv;
+#endif
     testRealization();
 }
\ No newline at end of file